@@ -0,0 +1,62 @@
+/*****************************************************************
+*
+*                          Function bench.c
+*
+*  timing harness of the benchmarks, see bench.h
+*
+******************************************************************/
+
+#include "hal.h"
+#include "uart0.h"
+#include "bench.h"
+
+#ifdef HAL_HOST
+#include <time.h>
+#endif
+
+// UART0 and the clock, then the title line
+void benchStart(const char *title){
+	uart0_init(38400);
+	uart0_puts("\n");
+	uart0_puts((char *) title);
+	uart0_puts(", per call in" BENCH_UNIT "\n");
+	#ifndef HAL_HOST
+	hal_timer_start(HAL_TIMER1, 0, 0xFFFFFFFF); // count PCLK
+	#endif
+}
+
+unsigned long benchNow(void){
+	#ifdef HAL_HOST
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return(now.tv_sec * 1000000000UL + now.tv_nsec);
+	#else
+	return(hal_timer_count(HAL_TIMER1));
+	#endif
+}
+
+// BENCH_COUNT calls from begin to end, return: per call in BENCH_UNIT x 10
+unsigned long benchPerCall(unsigned long begin, unsigned long end){
+	#ifdef HAL_HOST
+	return((end - begin) * 10 / BENCH_COUNT);
+	#else
+	return((end - begin) * CCLK_PER_PCLK * 10 / BENCH_COUNT);
+	#endif
+}
+
+// print value x 10 with one decimal
+void printTenths(unsigned long value){
+	uart0_print_int(value / 10);
+	uart0_putchar('.');
+	uart0_putchar('0' + value % 10);
+}
+
+// return: the exit code on the host, the target stays here
+int benchEnd(void){
+	uart0_puts("Done\n");
+	#ifndef HAL_HOST
+	while(1);
+	#endif
+	return(0);
+}
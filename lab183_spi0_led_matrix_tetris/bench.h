@@ -0,0 +1,32 @@
+/*****************************************************************
+*
+*                          Function bench.h
+*
+*  timing harness of tetris_bench.c and print_bench.c, a run times
+*  BENCH_COUNT calls between two benchNow() and reports the time per
+*  call x 10 so one decimal survives the integer division
+*
+*  target: Timer1 counts PCLK from benchStart(), results are CPU
+*  cycles (CCLK = 2 x PCLK), host: ns from the monotonic clock
+*
+******************************************************************/
+
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#ifdef HAL_HOST
+#define BENCH_UNIT " ns"
+#define BENCH_COUNT 1000000
+#else
+#define BENCH_UNIT " cycles"
+#define BENCH_COUNT 256
+#define CCLK_PER_PCLK 2
+#endif
+
+void benchStart(const char *);
+unsigned long benchNow(void);
+unsigned long benchPerCall(unsigned long, unsigned long);
+void printTenths(unsigned long);
+int benchEnd(void);
+
+#endif // __BENCH_H
@@ -0,0 +1,60 @@
+/*****************************************************************
+*
+*                          Function frame.c
+*
+*  compose the planes of a frame and turn them into the SPI column
+*  frames sent by the display scan
+*
+******************************************************************/
+
+#include "frame.h"
+
+/*
+ * compose planes from game->bgImage and, if showBlock, myBlock and
+ * its ghost
+ */
+void frameCompose(tetrisGame *game, char showBlock, unsigned int planes[BCM_PLANES][MAX_COL]){
+	int index, plane;
+	unsigned int data;
+	#if GHOST_LEVEL
+	int ghost = showBlock ? tetrisDropDistance(game) : 0;
+	#endif
+	
+	for(plane = 0; plane < BCM_PLANES; plane++){
+		for(index = 0; index < MAX_COL; index++){
+			data = 0;
+			if(BG_LEVEL & (1 << plane)){
+				data |= game->bgImage[index];
+			}
+			if(showBlock && (BLOCK_LEVEL & (1 << plane))){
+				data |= game->myBlock[index];
+			}
+			#if GHOST_LEVEL
+			if(showBlock && (GHOST_LEVEL & (1 << plane))){
+				data |= game->myBlock[index] << ghost;
+			}
+			#endif
+			planes[plane][index] = data;
+		}
+	}
+}
+
+/*
+ * planes into the column frames in scan order, column by column and
+ * plane by plane
+ * call once after the planes have been composed, before they are shown
+ */
+void frameBuild(unsigned int planes[BCM_PLANES][MAX_COL],
+	unsigned short frames[MAX_COL][BCM_PLANES][SPI_FRAME_SIZE]){
+	int index, plane;
+	unsigned short *frame = frames[0][0];
+	
+	for(index = 0; index < MAX_COL; index++){
+		for(plane = 0; plane < BCM_PLANES; plane++){
+			frame[0] = (planes[plane][index] >> MAX_COL) & DATA_MASK; // Row 31:16
+			frame[1] = planes[plane][index] & DATA_MASK; // Row 15:0
+			frame[2] = 1 << index; // column data
+			frame += SPI_FRAME_SIZE;
+		}
+	}
+}
@@ -0,0 +1,32 @@
+/*****************************************************************
+*
+*                          Function frame.h
+*
+*  display frames of the game, shared by rev3 and tetris_bench.c
+*
+*  binary code modulation, BCM_PLANES = 1 is plain on/off, each
+*  layer of the picture lights the planes set in its level
+*  plane word: bit n = row n of the column
+*
+******************************************************************/
+
+#ifndef __FRAME_H
+#define __FRAME_H
+
+#include "hal.h"
+#include "tetris.h"
+#include "spi0.h"
+
+#define BCM_PLANES 4
+#define LEVEL_FULL ((1 << BCM_PLANES) - 1)
+// brightness of each layer, 0 - LEVEL_FULL
+#define BG_LEVEL LEVEL_FULL
+#define BLOCK_LEVEL LEVEL_FULL
+// ghost piece at the hard drop position, 0 = off
+#define GHOST_LEVEL 0
+
+void frameCompose(tetrisGame *, char, unsigned int [BCM_PLANES][MAX_COL]);
+void frameBuild(unsigned int [BCM_PLANES][MAX_COL],
+	unsigned short [MAX_COL][BCM_PLANES][SPI_FRAME_SIZE]);
+
+#endif // __FRAME_H
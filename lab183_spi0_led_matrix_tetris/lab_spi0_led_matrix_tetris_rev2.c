@@ -455,8 +455,8 @@ void newShape(void){
 	currentRow = BASE_ROW;
 	newShapeFlag = 0;
 	objColOffset = 0;
+	blockColumns(currentShape, myBlock);
 	for(index = 0; index < MAX_COL; index++){
-		myBlock[index] = blockData[currentShape][index];
 		myBlock2[index] = myBlock[index]; // debug
 	}
 }
@@ -623,6 +623,7 @@ int rotateCW(void){
 	signed int tempIndex;
 	char tempShape;
 	unsigned int tempObj[MAX_COL];
+	unsigned int tempShapeCol[MAX_COL];
 	unsigned int mergeCheck;
 	
 	#if DEBUG_ROTATE
@@ -653,10 +654,11 @@ int rotateCW(void){
 			result = 0x400;			
 		}
 		else{
+			blockColumns(tempShape, tempShapeCol);
 			for(colIndex = 0; colIndex < MAX_COL; colIndex++){
 				tempIndex = colIndex-objColOffset;;
 				if(tempIndex >= 0 && tempIndex < MAX_COL){
-					tempObj[colIndex] = blockData[tempShape][tempIndex] << (currentRow - BASE_ROW);
+					tempObj[colIndex] = tempShapeCol[tempIndex] << (currentRow - BASE_ROW);
 				}
 				else{
 					tempObj[colIndex] = 0;
@@ -689,7 +691,7 @@ int rotateCW(void){
 			#endif
 			for(colIndex = 0; colIndex < MAX_COL; colIndex++){
 				myBlock[colIndex] = tempObj[colIndex];
-				myBlock2[colIndex] = blockData[tempShape][colIndex];
+				myBlock2[colIndex] = tempShapeCol[colIndex];
 				#if DEBUG_ROTATE
 				printf("0x%02x,", tempObj[colIndex]);
 				#endif
@@ -6,182 +6,183 @@
  * Frame data format
  * |   Frame 0   |    Frame 1   |   Frame 2   | 
  * | Row 31: 16  |   Row 15: 0  |   Col 15:0  |
+ * Transport: SPI0, or SSP when DISPLAY_SSP = 1 in spi0.h
+ * (SSP pushes the 3 frames into its FIFO in one burst)
  *
  * Timer0: used for scanning display 
  * default scan rate is 2 kHz per column
- * Timer1: used for user input update
- * scan rate: 1 kHz
- * PWM: used as a timer in the game time
- * default rate: 1 Hz
- * RTC: used to generate random number generator
- * together with T1PC (fast running clock)
+ * each column is shown as BCM_PLANES bit-planes (binary code
+ * modulation), plane n lasts BCM_UNIT << n ticks, T0MR0 is
+ * reloaded per plane
+ * SPI0 interrupt: sends the column frame queued by Timer0
+ * and pulses LATCH after the last frame
+ * PWM: ticks the timer wheel (wheel.c) at 1 kHz, it runs the user
+ * input update every INPUT_TICKS and the game step every
+ * gravityTicks, Timer1 is free
+ * UART0 interrupt: keys go into the receive ring of uart0.c, all of
+ * them are applied in the next loop pass and shown at the next input
+ * update, printf() output goes
+ * out from the transmit ring so it never holds up the game
+ * 't' switches on binary telemetry (telemetry.c), a record per game
+ * step and the board after every merge, time stamps count input
+ * updates (5 ms)
+ * 'm' mirrors the display (mirror.c), changed columns go out at most
+ * every MIRROR_INTERVAL frames for matrix_view.c on the host
+ * LCD: lines, level and the next piece on the 16x2 LCD (lcd.c), the
+ * program only writes the shadow buffer, inputTick() sends a nibble
+ * per update, the piece is drawn with CG RAM glyphs
+ * game step: 1 Hz at level 1, GRAVITY_DELTA faster per level, the
+ * new period starts from the next step so nothing is restarted
+ * RTC: CTC together with the timer counters seeds the piece
+ * generator once per game, read at the key that starts it (any key
+ * after reset, 'n' later) while the clocks run, pieces then come
+ * from a shuffled bag
+ * the seed and every game step are recorded (replay.c), 'p' dumps
+ * the record for tetris_replay.c on the host
+ *
+ * Hardware is reached through hal.h (lpc2138_lib), build with
+ * -DHAL_HOST to run on the host, see hal_host.c
  */
 
-#include <LPC213x.h>
+#include "hal.h"
 #include "lpc213x_vic.h"
 #include "spi0.h"
 #include "retarget.h"
 #include "uart0.h"
 #include "tetris.h"
+#include "frame.h"
+#include "replay.h"
+#include "telemetry.h"
+#include "mirror.h"
+#include "lcd.h"
+#include "format.h"
+#include "wheel.h"
 
 #define DEBUG1 0
 #define DEBUG2 0
 #define DEBUG3 1
-#define DEBUG_ROTATE 0
-
-#define BASE_ROW 2
 
 // timer constant
 #define T0PR_VALUE 29
 #define T0MR0_VALUE 500
-#define T1PR_VALUE 2949
-#define T1MR0_VALUE 49
-#define PWMPR_VALUE 2949
-#define PWMMR0_VALUE 10000
-#define PWMMR0_MIN 1000
-#define PWMMR0_DELTA 1000
-#define LEVEL_LIMIT 5
+// wheel ticks, WHEEL_HZ = 1 kHz
+#define INPUT_TICKS 5
+#define GRAVITY_TICKS 1000
+#define GRAVITY_MIN 100
+#define GRAVITY_DELTA 100
 
 #define REPEAT_COUNT 20
 #define INITIAL_OFFSET 8
-#define DATA_MASK 0xFFFF
 #define LATCH_DELAY 50
 #define TIMER_LED 8
 #define PROC1_LED 10
-#define BLOCK_LIST_COUNT 4
-
-#define load_pulse() {IO0CLR = LATCH; IO0SET = LATCH;}
-#define proc1_on()  {IO0CLR = (1 << PROC1_LED);}
-#define proc1_off() {IO0SET = (1 << PROC1_LED);}
+#define FRAME_BUFFERS 3
+#define STATUS_NEXT 3 // LCD columns of a space and the next piece
+
+// binary code modulation, BCM_PLANES in frame.h
+// the column period is kept at T0MR0_VALUE, split 1:2:4:..
+#define BCM_UNIT (T0MR0_VALUE/LEVEL_FULL)
+// shortest plane must cover one column frame on the bus plus ISR entry
+// SPI0: 48 bits at PCLK/15 = 24 ticks, SSP: 48 bits at PCLK/4 = 7 ticks
+#if DISPLAY_SSP
+#define BCM_MIN_UNIT 12
+#else
+#define BCM_MIN_UNIT 30
+#endif
+#if BCM_UNIT < BCM_MIN_UNIT
+#error "BCM_PLANES too deep for T0MR0_VALUE"
+#endif
+
+#define proc1_on()  hal_gpio_clr(0, 1 << PROC1_LED)
+#define proc1_off() hal_gpio_set(0, 1 << PROC1_LED)
 
 /******************************************* 
  * function prototype
  *******************************************/ 
-__irq void timer1IRQ(void);
 __irq void timer0IRQ(void);
-__irq void pwmIRQ(void);
+void inputTick(void);
+void gravityTick(void);
 void setupLed(void);
 void initDisp(void);
 void timer0Init(void);
 void timer0IntSetup(void);
-void timer1Init(void);
-void timer1IntSetup(void);
-void pwmInit(void);
-void pwmIntSetup(void);
-void pwmDecreaseTime(void);
+void gameTimerInit(void);
+void gravityDecreaseTime(void);
 void rtcInit(void);
+void waitStart(void);
 void disableTimer(void);
-void newShape(void);
-void mergeData(void);
-int collisionTest(void);
-void moveLeft(void);
-void moveRight(void);
-int clearRow(void);
+void buildScanFrame(char);
+void publishFrame(void);
+void composeFrame(char);
 void resetParam(void);
-void mergeDown(int);
-int rotateCW(void);
-int rotateCW2(void);
-int rotateCCW(void);
-int dropDown(void); 
-
-int collisionTest2(void);
-void moveLeft2(void);
+void showStatus(void);
+void statusLine(int, const char *, unsigned int);
+void showNext(void);
+unsigned int readSeed(void);
 
 // global variables
-unsigned int bgImage[MAX_COL];
-unsigned int myBlock[MAX_COL];
-unsigned int dispBuffer[2][MAX_COL];
-unsigned int myBlock2[MAX_COL];
+tetrisGame game; // board, block and piece queue, see tetris.h
+unsigned int dispBuffer[FRAME_BUFFERS][BCM_PLANES][MAX_COL];
+// ready-to-send SPI frames for each column and plane of dispBuffer
+unsigned short scanFrame[FRAME_BUFFERS][MAX_COL][BCM_PLANES][SPI_FRAME_SIZE];
+const unsigned short *scanPtr; // next column frame to be sent
+char bcmPlane; // plane being queued by timer0IRQ()
+// scan cost, Timer0 ticks spent in timer0IRQ() and planes that found
+// SPI still busy, printed by the 's' command
+unsigned int scanIsrTicks;
+unsigned int scanLate;
+volatile unsigned int scanFrames; // frames shown, times the mirror
 
 int displayColumn;
-int currentRow;
-char currentBuffer;
+// triple buffer, the three indices are always different
+char backBuffer;            // composed by main()
+volatile char readyBuffer;  // latest published frame
+volatile char frontBuffer;  // shown by timer0IRQ()
+volatile char frameReady;   // readyBuffer has not been shown yet
 char updateFlag;
 char moveFlag;
-char currentShape;
-char currentShapeVar;
-signed char objColOffset;
-char currentLevel;
-
-char endGameFlag;
-int clearRowFlag;
-int holdCount;
-char cmdFlag;
-char newShapeFlag;
-int collisionRow;
-int collisionRow2;
-int rotCollision;
-int dropCount;
 char ledFlag;
-int lineErase;
-char blockList[BLOCK_LIST_COUNT];
-unsigned char blockListIndex;
+wheel_timer inputTimer;   // user input update
+wheel_timer gravityTimer; // game step
+unsigned int gravityTicks;
 
 
 
 int main(void){
-  int index;
-	char cmd;
+	int events, cmd, policy;
+	char input;
+	char moved = 0;
 	
   setupLed(); // set up status LEDs
 	
 	uart0_init(38400);
 	uart0_puts("\nTetris\n");
+	uart0_init_int(); // receive into a ring, no key press is lost
+	lcd_init(); // calibrates on Timer1
+	lcd_fb_init();
 	// setup VIC
 	timer0IntSetup(); 
-	timer1IntSetup();
-	pwmIntSetup();
+	wheel_init(); // PWM, vector slot 2
+	init_SPI_int();
 	
-	// start program automatically when the core is reset
 	init_SPI(); // initailize SPI0 and enable display output
+	initDisp(); // blank until the game starts
+	timer0Init(); // the seed clocks run while waiting
+	rtcInit();
+	waitStart(); // first game at the first key
 	resetParam(); // reset all variables
 	initDisp(); // reset the display
 	timer0Init(); // start display refresh timer
-	timer1Init(); // start user input timer
 	rtcInit(); // initialize RTC
-  pwmInit(); // start game timer
+	gameTimerInit(); // start user input and game timers
 
 	while(1){
+		hal_idle();
 		
-		if(U0LSR & 0x1){
-			cmd = U0RBR;
-			switch(cmd){
-				case 'a': // move right
-					cmdFlag = 1;
-					break;
-				case 'f': // move left
-					 cmdFlag = 2;
-					break;
-				case 'r': // rotate
-					 cmdFlag = 3;
-					break;
-				case ' ':
-					 cmdFlag = 4;
-					break;
-				case 'd': // disable timer
-					disableTimer();
-					break;
-				case 'n': // start a new came
-					printf("New game\n");
-					disableTimer(); // disable timer
-				  resetParam(); // clear all paramerters
-					initDisp();  // initialize display
-					timer0Init(); // initialize Timer0
-					timer1Init(); // initialize Timer1
-					rtcInit(); // initialize RTC
-				  pwmInit();
-					break;
-				default: // unknown command
-					printf("0x%02x\n",cmd);
-					cmdFlag = 0;
-					break;
-			}
-		}
-		
-		if(moveFlag && !endGameFlag){
+		if(moveFlag && !game.endGameFlag){
 			
 			#if DEBUG1
-			printf("\nRow %2d, ", currentRow);
+			printf("\nRow %2d, ", game.currentRow);
 			#endif
 			#if DEBUG2
 			proc1_on();
@@ -189,100 +190,42 @@ int main(void){
 			
 			ledFlag ^= 0x1;
 			if(ledFlag & 0x1){
-				IO0CLR = (1 << TIMER_LED);
+				hal_gpio_clr(0, 1 << TIMER_LED);
 			}
 			else{
-				IO0SET = (1 << TIMER_LED);
+				hal_gpio_set(0, 1 << TIMER_LED);
 			}
 			
-				if(newShapeFlag){
-					newShape();  // generate new block
-					for(index = 0; index < MAX_COL; index++){
-						dispBuffer[currentBuffer^(0x1)][index] = bgImage[index] | myBlock[index];
-					}
+			events = tetrisStep(&game, CMD_NONE, 1);
+			replayStep(CMD_NONE, 1);
+			#if DEBUG3
+			if((events & EVENT_LINES) && !telemOn){
+				printf("Line erase: %3d\n", game.lineErase);
+			}
+			#endif
+			telemStep(&game, events);
+			// increase time
+			if(events & EVENT_LEVEL_UP){
+				gravityDecreaseTime();
+				printf("Level: %2d\n", game.currentLevel);
+			}
+			if(events & EVENT_GAME_OVER){
+				if(events & EVENT_MERGED){
+					printf("Game over 2\n");
+					disableTimer();
+					showStatus();
+					lcd_fb_flush(); // inputTick() no longer sends it
 				}
 				else{
-					currentRow++; // move the next column	
-					// detect collision between myBlock and bgImage
-					if(currentRow >= MAX_ROW){
-						#if DEBUG1
-						uart0_puts(" Bottom");
-						#endif
-						newShapeFlag = 1;
-						currentRow = BASE_ROW;
-					}				
-
-				// test collision if move down
-				collisionRow = collisionTest();
-				#if DEBUG1
-				printf("Test2: %2d ", collisionRow);
-				#endif
-					
-				// merge background with the block if collision or reach bottom
-				if(collisionRow > BASE_ROW){
-					#if DEBUG1
-					printf("Collis: %d",collisionRow);
-					#endif
-					for(index = 0; index < MAX_COL; index++){
-						// should this be  
-						bgImage[index] = bgImage[index] | (myBlock[index]);
-					}
-					clearRowFlag = clearRow(); // clear data
-					if(clearRowFlag){
-						#if DEBUG1
-						printf("\nFull Row: 0x%08x\n",clearRowFlag);
-						#endif						
-						mergeDown(clearRowFlag);
-						clearRowFlag = 0;
-						#if DEBUG3
-						printf("Line erase: %3d\n", lineErase);
-						#endif
-						// increase time
-						if(lineErase >= ((currentLevel + 1)*LEVEL_LIMIT)){ 
-							pwmDecreaseTime();
-							currentLevel++;
-							printf("Level: %2d\n", currentLevel);
-						}
-					}
-					// update the next buffer
-					for(index = 0; index < MAX_COL; index++){
-						dispBuffer[currentBuffer^(0x1)][index] = bgImage[index];
-					}
-					// check if the background grew over base row
-					if(collisionRow <= BASE_ROW + 2){
-						for(index = 0; index < MAX_COL; index++){
-							if(bgImage[index] & ((1 << (BASE_ROW + 1)) - 1)){
-								endGameFlag = 1;
-								printf("Game over 2\n");
-								disableTimer();
-								newShapeFlag = 0;
-							}
-						}
-					}
-				}
-				else if(collisionRow == BASE_ROW){
-					// update the next buffer
-					for(index = 0; index < MAX_COL; index++){
-						dispBuffer[currentBuffer^(0x1)][index] = bgImage[index] | myBlock[index];
-					}					
-					newShapeFlag = 0;
-					endGameFlag = 1;
 					printf("Game over\n"); // notify user
-					//disableTimer();
-				}
-				// no collision detected just move down the block
-				else{
-					for(index = 0; index < MAX_COL; index++){
-						myBlock[index] = myBlock[index] << 1;					
-					}
-					// update the next buffer with background and block
-					for(index = 0; index < MAX_COL; index++){
-						dispBuffer[currentBuffer^(0x1)][index] = bgImage[index] | myBlock[index];
-					}
 				}
-									
-			}		
-			currentBuffer ^= 0x1; // change buffer			
+			}
+			if(events & (EVENT_NEW_BLOCK | EVENT_LINES | EVENT_LEVEL_UP | EVENT_GAME_OVER)){
+				showStatus();
+			}
+			// update the next buffer with background and block
+			composeFrame(game.showBlock);
+			publishFrame(); // show the new frame from the next frame start
 			moveFlag = 0; // reset flag
 			
 			// move process debugging
@@ -292,36 +235,98 @@ int main(void){
 		}
 		
 		
-		// user input
-		if(updateFlag && cmdFlag){
-
-			if(cmdFlag == 1){
-				moveLeft();
-			}
-			else if(cmdFlag == 2){
-				moveRight();
-			}
-			else if(cmdFlag == 3){
-				rotCollision = rotateCW();
-				#if DEBUG1
-				printf("Rot: %d ", rotCollision);
-				#endif
+		// user input, every command received so far
+		while((cmd = uart0_try_getchar()) >= 0){
+			input = CMD_NONE;
+			switch(cmd){
+				case 'a': // move right
+					input = CMD_LEFT;
+					break;
+				case 'f': // move left
+					input = CMD_RIGHT;
+					break;
+				case 'r': // rotate
+					input = CMD_ROTATE_CW;
+					break;
+				case 'e': // rotate counterclockwise
+					input = CMD_ROTATE_CCW;
+					break;
+				case 'w': // rotate 180 degrees
+					input = CMD_ROTATE_180;
+					break;
+				case ' ':
+					input = CMD_DROP;
+					break;
+				case 'd': // disable timer
+					disableTimer();
+					break;
+				case 's': // display scan statistics
+					printf("Scan: %d planes, %u ticks/ISR max, %u late\n",
+						BCM_PLANES, scanIsrTicks, scanLate);
+					printf("UART0: %u in, %u out dropped\n", uart0RxDropped, uart0TxDropped);
+					telemCounter(TELEM_SCAN_TICKS, scanIsrTicks);
+					telemCounter(TELEM_SCAN_LATE, scanLate);
+					telemCounter(TELEM_RX_DROPPED, uart0RxDropped);
+					telemCounter(TELEM_TX_DROPPED, uart0TxDropped);
+					break;
+				case 't': // binary telemetry on or off
+					telemOn ^= 1;
+					printf("Telemetry %s\n", telemOn ? "on" : "off");
+					telemBoard(&game);
+					break;
+				case 'm': // display mirror on or off
+					mirrorOn ^= 1;
+					printf("Mirror %s\n", mirrorOn ? "on" : "off");
+					mirrorStart();
+					composeFrame(game.showBlock); // capture what is shown now
+					publishFrame();
+					break;
+				case 'p': // dump the replay record of this game, all of it
+					policy = uart0_set_tx_policy(UART0_TX_BLOCK);
+					replayDump(tetrisHash(&game));
+					uart0_set_tx_policy(policy);
+					break;
+				case 'n': // start a new came
+					printf("New game\n");
+					disableTimer(); // disable timer
+					resetParam(); // clear all paramerters
+					initDisp();  // initialize display
+					timer0Init(); // initialize Timer0
+					rtcInit(); // initialize RTC
+					gameTimerInit();
+					break;
+				default: // unknown command
+					printf("0x%02x\n",cmd);
+					break;
 			}
-			else if(cmdFlag == 4){
-				dropCount = dropDown();
+			if(input != CMD_NONE){
+				if(!game.endGameFlag){
+					replayStep(input, 0); // input after the end changes nothing
+				}
+				events = tetrisStep(&game, input, 0);
+				if(events){
+					telemStep(&game, events);
+				}
+				if(events & (EVENT_NEW_BLOCK | EVENT_LINES | EVENT_LEVEL_UP | EVENT_GAME_OVER)){
+					showStatus();
+				}
 				#if DEBUG1
-				printf("Drop: %d ", dropCount);
+				printf("Cmd: %d %d ", input, events);
 				#endif
+				moved = 1;
 			}
-
-			cmdFlag = 0;
-			for(index = 0; index < MAX_ROW; index++){
-				dispBuffer[currentBuffer^(0x1)][index] = bgImage[index] | myBlock[index];
-			}	
-			
-			currentBuffer ^= 0x1; // change buffer	
+		}
+		// show the moves at the next input update, an update with no
+		// move is used up too so the next key waits for the one after
+		if(updateFlag){
 			updateFlag = 0;
+			if(moved){
+				composeFrame(game.showBlock);
+				publishFrame(); // show the new frame from the next frame start
+				moved = 0;
+			}
 		}
+		mirrorPoll(scanFrames);
 
 	}
 }
@@ -331,473 +336,248 @@ int main(void){
  */
 
 void initDisp(void){
-	char index;
+	char index, plane;
 	
-	for(index = 0; index < MAX_ROW; index++){
-		dispBuffer[0][index] = 0;
-		dispBuffer[1][index] = 0;
-		bgImage[index] = 0;
+	for(index = 0; index < MAX_COL; index++){
+		for(plane = 0; plane < BCM_PLANES; plane++){
+			dispBuffer[0][plane][index] = 0;
+			dispBuffer[1][plane][index] = 0;
+			dispBuffer[2][plane][index] = 0;
+		}
 	}
+	buildScanFrame(0);
+	buildScanFrame(1);
+	buildScanFrame(2);
 }
 
-/*********************************************
- * Timer0 initialization
- *********************************************/
-void timer0Init(void){
-  T0TCR = 0x2; // reset timer and hold  
-	T0CTCR = 0x0; // set bit 1:0 to 0 for timer operation
-  T0PR = T0PR_VALUE; // set timer0 pre-scaler
-  T0MR0 = T0MR0_VALUE-1; // set timer0 MR0
-  T0MCR &= 0xF000; // reset T0MCR bit 11:0
-  T0MCR |= 0x3; // when counter reach target value
-	              // generate timer0 interrupt, reset, and stop
-  T0TCR = 0x1; // start timer	
+/*
+ * compose the back buffer planes from the game, see frameCompose()
+ */
+void composeFrame(char showBlock){
+	frameCompose(&game, showBlock, dispBuffer[backBuffer]);
+}
+
+/*
+ * convert dispBuffer[buffer] into the SPI frames sent by timer0IRQ()
+ * call once after the buffer has been composed, before it is shown
+ */
+void buildScanFrame(char buffer){
+	frameBuild(dispBuffer[buffer], scanFrame[buffer]);
+}
+
+/*
+ * publish dispBuffer[backBuffer] as the latest frame
+ * back and ready are swapped with Timer0 masked, timer0IRQ() swaps
+ * ready and front at column 0, so a frame is never shown half drawn
+ * and main() never waits for the display
+ */
+void publishFrame(void){
+	char temp;
+	
+	buildScanFrame(backBuffer);
+	mirrorCapture(dispBuffer[backBuffer][0], BCM_PLANES);
+	hal_irq_disable(VIC_TIMER0); // keep timer0IRQ() out of the swap
+	temp = readyBuffer;
+	readyBuffer = backBuffer;
+	backBuffer = temp;
+	frameReady = 1;
+	hal_irq_enable(VIC_TIMER0);
 }
 
 /*********************************************
- * Timer1 initialization
+ * Timer0 initialization
  *********************************************/
-void timer1Init(void){
-  T1TCR = 0x2; // reset timer and hold  
-	T1CTCR = 0x0; // set bit 1:0 to 0 for timer operation
-  T1PR = T1PR_VALUE; // set timer1 pre-scaler
-  T1MR0 = T1MR0_VALUE-1; // set timer1 MR0
-  T1MCR &= 0xF000; // reset T1MCR bit 11:0
-  T1MCR |= 0x3; // when counter reach target value
-	              // generate timer1 interrupt, reset
-  T1TCR = 0x1; // start timer	
+void timer0Init(void){
+	// when counter reach target value generate timer0 interrupt and reset
+  hal_timer_start(HAL_TIMER0, T0PR_VALUE, T0MR0_VALUE-1);
 }
 
 /*********************************************
- * PWM initialization
+ * user input and game timers, on the wheel
  *********************************************/
-void pwmInit(void){
-  PWMTCR = 0x2; // reset timer and hold  
-  PWMPR = PWMPR_VALUE; // set timer0 pre-scaler
-  PWMMR0 = PWMMR0_VALUE-1; // set timer0 MR0
-  PWMMCR = 0x3; // generate interrupt, reset, and stop	              
-  PWMTCR = 0x1; // start timer	
+void gameTimerInit(void){
+	gravityTicks = GRAVITY_TICKS;
+	wheel_start(&inputTimer, INPUT_TICKS, INPUT_TICKS, inputTick);
+	wheel_start(&gravityTimer, gravityTicks, gravityTicks, gravityTick);
 }
 
 /*********************************************
- * PWM change time
+ * game step change time, from the next step on
  *********************************************/
-void pwmDecreaseTime(void){
-	if(PWMMR0 > PWMMR0_MIN){
-  PWMTCR = 0x2; // reset timer and hold  
-  //PWMPR = PWMPR_VALUE; // set timer0 pre-scaler
-  PWMMR0 = PWMMR0 - PWMMR0_DELTA; // set timer0 MR0
-  PWMMCR = 0x3; // generate interrupt, reset, and stop	              
-  PWMTCR = 0x1; // start timer	
+void gravityDecreaseTime(void){
+	if(gravityTicks > GRAVITY_MIN){
+		gravityTicks -= GRAVITY_DELTA;
+		wheel_set_period(&gravityTimer, gravityTicks);
 	}
 }
 
 
 
 void timer0IntSetup(void){
-  VICIntSelect &= ~(1 << VIC_TIMER0); // use TIMER0 in Vectored IRQ mode
-  VICVectAddr0 = (unsigned int) timer0IRQ; // assigned interrupt function
-  VICVectCntl0 = 0x20 | VIC_TIMER0;  // vector slot 0 assigned for TIMER0
-  VICIntEnable |= (1 << VIC_TIMER0); // enable TIMER0 	
-}
-
-void timer1IntSetup(void){
-  VICIntSelect &= ~(1 << VIC_TIMER1); // use TIMER1 in Vectored IRQ mode
-  VICVectAddr1 = (unsigned int) timer1IRQ; // assigned interrupt function
-  VICVectCntl1 = 0x20 | VIC_TIMER1;  // vector slot 1 assigned for TIMER1
-  VICIntEnable |= (1 << VIC_TIMER1); // enable TIMER1 	
-}
-
-void pwmIntSetup(void){
-  VICIntSelect &= ~(1 << VIC_PWM0); // use PWM in Vectored IRQ mode
-  VICVectAddr2 = (unsigned int) pwmIRQ; // assigned interrupt function
-  VICVectCntl2 = 0x20 | VIC_PWM0;  // vector slot 2 assigned for PWM
-  VICIntEnable |= (1 << VIC_PWM0); // enable PWM 	
+  hal_irq_install(0, VIC_TIMER0, timer0IRQ); // vector slot 0 assigned for TIMER0
 }
 
 __irq void timer0IRQ(void){  
-	write_SPI((dispBuffer[currentBuffer][displayColumn] >> MAX_COL) & DATA_MASK);
-	write_SPI(dispBuffer[currentBuffer][displayColumn] & DATA_MASK);
-	write_SPI(1 << displayColumn); // column data
-	load_pulse();
-	displayColumn = (displayColumn+1) & 0xF; // update row
-  T0IR = 0x1; // clear TIMER0 MR0 interrupt
-  VICVectAddr = 0; // return interrupt  
+	char temp;
+	
+	// queue the column plane and return, spi0IRQ() sends the rest
+	// if the previous plane is still shifting out, show it one more tick
+	if(spiBusy){
+		scanLate++;
+	}
+	else{
+		if(displayColumn == 0 && bcmPlane == 0){
+			// frame boundary, pick up the latest published frame
+			if(frameReady){
+				temp = frontBuffer;
+				frontBuffer = readyBuffer;
+				readyBuffer = temp;
+				frameReady = 0;
+			}
+			scanPtr = scanFrame[frontBuffer][0][0]; // start of a new frame
+			scanFrames++;
+		}
+		write_SPI_frame(scanPtr, SPI_FRAME_SIZE);
+		scanPtr += SPI_FRAME_SIZE;
+		hal_timer_set_match(HAL_TIMER0, (BCM_UNIT << bcmPlane) - 1); // weight of this plane
+		bcmPlane++;
+		if(bcmPlane == BCM_PLANES){
+			bcmPlane = 0;
+			displayColumn = (displayColumn+1) & 0xF; // update row
+		}
+	}
+  hal_timer_clear_int(HAL_TIMER0); // clear TIMER0 MR0 interrupt
+	// TC restarted at the match, so it holds the ticks spent here
+	if(hal_timer_count(HAL_TIMER0) > scanIsrTicks){
+		scanIsrTicks = hal_timer_count(HAL_TIMER0);
+	}
+  hal_irq_end(); // return interrupt  
 }
 
-__irq void timer1IRQ(void){
+// wheel handlers, run in the PWM interrupt
+void inputTick(void){
 	updateFlag = 1;
-  T1IR = 0x1; // clear TIMER1 MR0 interrupt
-  VICVectAddr = 0; // return interrupt  
+	telemTime++;
+	lcd_fb_tick(); // a nibble of the LCD changes, if any
 }
 
-__irq void pwmIRQ(void){
+void gravityTick(void){
 	moveFlag = 1;
-  PWMIR = 0x1; // clear TIMER1 MR0 interrupt
-  VICVectAddr = 0; // return interrupt  
 }
 
 void rtcInit(void){
-	CCR = 0x11;
+	hal_rtc_init();
 }
 
-// disable pwm timer and user input timer 
+/*
+ * wait for a key after reset, the time it takes is the entropy of
+ * the first seed, the clocks would read the same at every power on
+ * otherwise, the host starts at once so that its simulated clocks
+ * give the same first seed at every run
+ */
+void waitStart(void){
+#ifndef HAL_HOST
+	printf("Press a key\n");
+	lcd_fb_print(0, 0, "Press a key");
+	lcd_fb_flush(); // no input timer yet
+	while(uart0_try_getchar() < 0){
+		hal_idle();
+	}
+#endif
+}
+
+// disable game timer and user input timer 
 void disableTimer(void){
-	PWMTCR = 0x2;
-  PWMIR = 0x1;	
-	T1TCR = 0x2;
-	T1IR = 0x1;
+	wheel_cancel(&gravityTimer);
+	wheel_cancel(&inputTimer);
 }
 
 
 void setupLed(void){
-	PINSEL0 &= ~((3 << (TIMER_LED << 1)) | (3 << (PROC1_LED << 1)));
-	IO0DIR |= (1 << TIMER_LED) | (1 << PROC1_LED); //
-	IO0CLR = (1 << TIMER_LED); // turn on LED
-	IO0SET = (1 << PROC1_LED);
+	hal_gpio_output(0, (1 << TIMER_LED) | (1 << PROC1_LED));
+	hal_gpio_clr(0, 1 << TIMER_LED); // turn on LED
+	hal_gpio_set(0, 1 << PROC1_LED);
 }
 
 void resetParam(void){
-	int index;
 	displayColumn = 0;
-	currentRow = BASE_ROW;
-  currentBuffer = 0;
+	bcmPlane = 0;
+	scanIsrTicks = 0;
+	scanLate = 0;
+  backBuffer = 0;
+	readyBuffer = 1;
+	frontBuffer = 2;
+	frameReady = 0;
 	updateFlag = 0;
 	moveFlag = 0;
-	newShapeFlag = 1;
-	endGameFlag = 0;
-	cmdFlag = 0;
-	clearRowFlag = 0;
   ledFlag = 0;
-  lineErase = 0;
-	currentLevel = 1;
-  blockListIndex = 0;
-	for(index = 0; index < BLOCK_LIST_COUNT; index++){
-		blockList[index] = BLOCK_SHAPE*BLOCK_VAR;
-	}
+	tetrisInit(&game, readSeed());
+	printf("Seed: 0x%08x\n", game.seed);
+	replayStart(game.seed);
+	showStatus();
 }
 
-void newShape(void){
-	int index;
-	char temp;
-	
-	temp = (((CTC >> 1) ^ T1PC) & 0x7);
-	if(temp == (currentShape >> 2)){ 
-		currentShape = ((temp + T0PC) & 0x7) << 2;
+/*
+ * lines, level and the next piece on the LCD, RAM writes only
+ */
+void showStatus(void){
+	statusLine(0, "Lines", game.lineErase);
+	showNext();
+	if(game.endGameFlag){
+		lcd_fb_print(1, 0, "Game over       ");
 	}
 	else{
-		currentShape = temp << 2;
-	}
-//	do{
-//		
-//		if((blockList[(blockListIndex - 1) & 0x7] != temp) &&
-//			 (blockList[(blockListIndex - 2) & 0x7] != temp)){
-//			currentShape = temp;
-//			break;
-//		}
-//	}
-//	while(newShape);
-	
-	
-	//currentShape = ((((CTC >> 1) ^ T1PC) + T0PC + 3) & 0x7) << 2;
-	currentShapeVar = 0;
-	currentRow = BASE_ROW;
-	newShapeFlag = 0;
-	objColOffset = 0;
-	for(index = 0; index < MAX_COL; index++){
-		myBlock[index] = blockData[currentShape][index];
-		myBlock2[index] = myBlock[index]; // debug
+		statusLine(1, "Level", game.currentLevel);
 	}
 }
 
-void mergeData(void){
+// label on the left, value on the right of an LCD row, the last
+// STATUS_NEXT columns of the row are left to the next piece
+void statusLine(int row, const char *label, unsigned int value){
+	char line[LCD_COLS - STATUS_NEXT + 1];
+	char number[FMT_SIZE];
 	int index;
-	for(index = 0; index < MAX_ROW; index++){
-		bgImage[index] = bgImage[index] | myBlock[index];					
-	}
-}
-
-
-int collisionTest(void){
-	int rowIndex, colIndex;
-	int mergeCheck;
-	int result = 0;
+	int width = LCD_COLS - STATUS_NEXT;
+	int count = fmt_uint(number, value);
 	
-	for(colIndex = 0; colIndex < MAX_COL; colIndex++){
-		mergeCheck = bgImage[colIndex] & (myBlock[colIndex] << 1); 
-		if(mergeCheck){			// if this is true
-			for(rowIndex = MAX_ROW-1; rowIndex >= 0; rowIndex--){
-				if(mergeCheck & (1 << rowIndex)){
-					result = rowIndex - 1; // return result
-				}
-			}
-			newShapeFlag = 1;
-			break;
-		}
-		else if((myBlock[colIndex]) & 0x80000000){		
-//		else if((myBlock[colIndex] << 1) & 0x80000000){
-			result = 0x100; // end of column
-			newShapeFlag = 1;
-			break; 
-		}
+	for(index = 0; index < width; index++){
+		line[index] = ' ';
 	}
-	
-	return (result);
-}
-
-
-int collisionTest2(void){
-	int rowIndex, colIndex;
-	int mergeCheck;
-	int result = 0;
-	
-	for(colIndex = 0; colIndex < MAX_COL; colIndex++){
-		mergeCheck = bgImage[colIndex] & (myBlock2[colIndex] << (currentRow - BASE_ROW)); 
-		if(mergeCheck){			// if this is true
-			for(rowIndex = 0; rowIndex < BLOCK_SIZE; rowIndex++){
-				if(mergeCheck & (1 << (rowIndex + currentRow))){
-					result = rowIndex + currentRow - 1; // return result
-				}
-			}
-			//newShapeFlag = 1;
-			break;
-		}
-		else if((myBlock2[colIndex] << (currentRow - BASE_ROW)) & 0x80000000){
-			result = 0x100; // bottom row
-			//newShapeFlag = 1;
-			break; 
-		}
-	}	
-	return (result);
-}
-
-// check if the object can be move left
-void moveLeft(void){
-	int colIndex;
-	char sideCollision = 0;
-	
-	if(!(myBlock[0])){
-		for(colIndex = 0; colIndex < MAX_COL-1; colIndex++){
-			if(bgImage[colIndex] & myBlock[colIndex+1]){
-				sideCollision = 1; // collided if move
-			}
-		}
-		// valid move
-		if(sideCollision == 0){
-			for(colIndex = 0; colIndex < MAX_COL - 1; colIndex++){
-				myBlock[colIndex] = myBlock[colIndex+1];
-			}
-			myBlock[MAX_COL - 1] = 0;
-			objColOffset--;
-		}
+	for(index = 0; label[index] != 0 && index < width; index++){
+		line[index] = label[index];
 	}
-	
-}
-
-void moveLeft2(void){
-
-	
-}
-
-void moveRight(void){
-	int colIndex;
-	char sideCollision = 0;
-	
-	if(!(myBlock[MAX_COL-1])){
-		for(colIndex = MAX_COL-1; colIndex > 0; colIndex--){
-			if(bgImage[colIndex] & myBlock[colIndex-1]){
-				sideCollision = 1; // collided if move
-			}
-		}
-		
-		if(sideCollision == 0){
-			for(colIndex = MAX_COL-1; colIndex > 0; colIndex--){
-				myBlock[colIndex] = myBlock[colIndex-1];
-			}
-			myBlock[0] = 0;
-			objColOffset++;
-		}
-	}	
-}
-
-// check for the full columns
-int clearRow(void){
-	int result = 0;
-	int index, index2;
-	int collapseData = bgImage[0];
-	
-	// combine all row together
-	for(index = 1; index < MAX_COL; index++){
-		collapseData &= bgImage[index]; 
+	for(index = 0; index < count; index++){
+		line[width - count + index] = number[index];
 	}
-	
-	if(collapseData){
-		for(index = 0; index < MAX_ROW; index++){
-			if(collapseData & (1 << index)){
-				lineErase++; // increase line count
-				for(index2 = 0; index2 < MAX_ROW; index2++){
-					bgImage[index2] &= ~(1 << index); // clear bit
-				}
-			}
-		}
-		result = collapseData;
-	}
-	return(result);
+	line[width] = 0;
+	lcd_fb_print(row, 0, line);
 }
 
-void mergeDown(int data){
-	int index, index2;
-	int dataMask, tempData;
+/*
+ * next piece in the top right corner as two glyphs of two block
+ * columns each, a block is 2x2 pixels, a piece seen before is still
+ * in CG RAM and costs no upload
+ */
+void showNext(void){
+	unsigned char bitmap[8];
+	char text[3];
+	unsigned int data;
+	int half, row;
 	
-	for(index = 1; index < MAX_ROW; index++){
-		if(data & (1 << index)){
-			#if DEBUG1
-				printf(" M: %d ", index); 
-			#endif
-			dataMask = ((1 << index)-1);
-			for(index2 = 0; index2 < MAX_COL; index2++){
-				tempData = (bgImage[index2] & dataMask) << 1; // keep unchange data
-				bgImage[index2] = (bgImage[index2] & ~dataMask) | tempData ;
-			}
+	for(half = 0; half < 2; half++){
+		for(row = 0; row < 8; row++){
+			data = blockData[(int) game.blockList[game.blockListIndex]] >> (BLOCK_SIZE*(row >> 1) + 2*half);
+			bitmap[row] = ((data & 0x1) ? 0x18 : 0) | ((data & 0x2) ? 0x06 : 0);
 		}
+		text[half] = lcd_glyph(bitmap);
 	}
+	text[2] = 0;
+	lcd_fb_print(0, LCD_COLS - 2, text);
 }
 
-
-int rotateCW(void){
-	int result = 0;
-	int colIndex, rowIndex;
-	signed int tempIndex;
-	char tempShape;
-	unsigned int tempObj[MAX_COL];
-	unsigned int mergeCheck;
-	
-	#if DEBUG_ROTATE
-	printf("Debug-r: %2d ",currentShape);
-	#endif
-	if(((currentShape >> 2) & 0x7) >= 2){
-		tempShape = (((currentShape & 0x3) + 1) & 0x3) + (currentShape & 0x1C);
-		#if DEBUG_ROTATE
-		printf("T1: %2d %2d\n", tempShape,objColOffset);
-		#endif
-		// check all collision first
-		if(objColOffset >= 7){
-			#if DEBUG_ROTATE
-			printf("Hit right wall\n");
-			#endif
-			result = 0x200;
-		}
-		else if(objColOffset <= -8){
-			#if DEBUG_ROTATE
-			printf("Hit left wall\n");
-			#endif
-			result = 0x400;
-		}
-		else if((currentShape == 9 || currentShape == 11) && objColOffset <= -7){
-			#if DEBUG_ROTATE
-			printf("Hit left wall for I shape\n");
-			#endif
-			result = 0x400;			
-		}
-		else{
-			for(colIndex = 0; colIndex < MAX_COL; colIndex++){
-				tempIndex = colIndex-objColOffset;;
-				if(tempIndex >= 0 && tempIndex < MAX_COL){
-					tempObj[colIndex] = blockData[tempShape][tempIndex] << (currentRow - BASE_ROW);
-				}
-				else{
-					tempObj[colIndex] = 0;
-				}
-				// check collision
-				mergeCheck = tempObj[colIndex] & bgImage[colIndex];
-				if(mergeCheck){			// if this is true
-					#if DEBUG_ROTATE
-					printf("can't rotate\n");
-					#endif
-					for(rowIndex = MAX_ROW-1; rowIndex >= 0; rowIndex--){
-						if(mergeCheck & (1 << rowIndex)){
-							result = rowIndex - 1; // return result
-						}
-					}
-				}
-				else if((tempObj[colIndex] << 1) & 0x80000000){
-					result = 0x100; // end of column
-					#if DEBUG_ROTATE
-					printf("rot: reach bottom\n");
-					#endif
-				}
-			}
-		}
-		// if it can be moved
-		if(result == 0){
-			currentShape = tempShape;
-			#if DEBUG_ROTATE
-			uart0_putchar('\n');
-			#endif
-			for(colIndex = 0; colIndex < MAX_COL; colIndex++){
-				myBlock[colIndex] = tempObj[colIndex];
-				myBlock2[colIndex] = blockData[tempShape][colIndex];
-				#if DEBUG_ROTATE
-				printf("0x%02x,", tempObj[colIndex]);
-				#endif
-			}
-			#if DEBUG_ROTATE
-			uart0_putchar('\n');			
-			#endif
-		}
-	}
-	return(result);
-}
-
-
-int rotateCCW(void){
-	int result = 0;
-	
-	return(result);
-}
-
-
-int dropDown(void){
-  int index,index2;
-	int dropCount[MAX_COL];
-  int dropMax;	
-	
-	for(index = 0; index < MAX_COL; index++){
-		dropCount[index] = MAX_ROW;
-		if(myBlock[index]){
-			if(bgImage[index] == 0){
-				for(index2 = currentRow; index2 < MAX_ROW; index2++){
-					if(myBlock[index] & (1 << index2)){
-						dropCount[index] = MAX_ROW - index2 - 1;
-					}
-					else if((myBlock[index] & (1 << index2)) == 0){
-						break; // exit
-					}
-				}
-			}
-			else{
-				for(index2 = 0; index2 < MAX_ROW; index2++){
-					if(bgImage[index] & (myBlock[index] << index2)){
-						dropCount[index] = index2 - 1;
-						break;
-					}
-				}
-			}
-		}
-	}
-	
-	dropMax = dropCount[0];
-	for(index = 1; index < MAX_COL; index++){
-		if(dropMax > dropCount[index]){
-			dropMax = dropCount[index];
-		}
-	}
-	
-	for(index = 0; index < MAX_COL; index++){
-		myBlock[index] = (myBlock[index] << dropMax);
-	}	
-	
-	currentRow = currentRow + dropMax;
-	
-	return dropMax;
+// entropy for the seed, the RTC and timer counts at game start
+unsigned int readSeed(void){
+	return((hal_rtc_count() << 16) ^ (wheel_now() << 8) ^
+		hal_timer_count(HAL_PWM) ^ hal_timer_count(HAL_TIMER0) ^
+		(hal_timer_prescale_count(HAL_TIMER0) << 24));
 }
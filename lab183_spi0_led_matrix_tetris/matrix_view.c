@@ -0,0 +1,127 @@
+/*****************************************************************
+*
+*                          Function matrix_view.c
+*
+*  shows the display mirror (mirror.h) in a terminal on the host,
+*  the frame is rebuilt from the TELEM_FRAME records, other records
+*  are skipped and text is shown under the picture
+*
+*  gcc -O2 -DHAL_HOST -I../lpc2138_lib -o matrix_view
+*      matrix_view.c telemetry.c uart0.c ../lpc2138_lib/format.c
+*      ../lpc2138_lib/hal_host.c
+*  stty -F /dev/ttyUSB0 38400 raw
+*  ./matrix_view [-s] [file]
+*    -s     scroll, print every frame below the last one, no cursor
+*           control, for a log
+*    file   serial port or capture, standard input if not given
+*
+******************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "telemetry.h"
+
+#define TEXT_SIZE 64
+
+static unsigned int image[MAX_COL];
+static unsigned short known;   // columns received since the start
+static char text[TEXT_SIZE];   // last line of text
+static char line[TEXT_SIZE];   // line being received
+static int lineCount;
+static int scroll;
+static telemReader reader;
+static unsigned long frames;
+
+// one line per display row, row 0 at the top, column 0 at the left
+static void draw(unsigned int time){
+	int row, col;
+
+	if(!scroll){
+		printf("\033[H\033[J"); // home and clear
+	}
+	printf("+");
+	for(col = 0; col < MAX_COL; col++){
+		printf("--");
+	}
+	printf("+\n");
+	for(row = 0; row < MAX_ROW; row++){
+		printf("|");
+		for(col = 0; col < MAX_COL; col++){
+			if(!(known & (1 << col))){
+				printf(" ?");
+			}
+			else{
+				printf(image[col] & (1UL << row) ? "[]" : " .");
+			}
+		}
+		printf("|\n");
+	}
+	printf("+");
+	for(col = 0; col < MAX_COL; col++){
+		printf("--");
+	}
+	printf("+\n");
+	printf("time %u, %lu frames, %lu lost\n%s\n", time, frames, reader.lost, text);
+	fflush(stdout);
+}
+
+// a record, only TELEM_FRAME changes the picture
+static void applyRecord(const unsigned char *frame, int size, int missed){
+	const unsigned char *data = frame + TELEM_HEADER;
+	int index;
+
+	(void) missed; // counted by the reader
+	if(frame[0] != TELEM_FRAME || size % 5){
+		return;
+	}
+	for(index = 0; index < size; index += 5){
+		if(data[index] < MAX_COL){
+			image[data[index]] = telemGet32(data + index + 1);
+			known |= 1 << data[index];
+		}
+	}
+	frames++;
+	draw(telemGet32(frame + 2));
+}
+
+// text between records, the last line is kept
+static void addText(const unsigned char *chunk, int count){
+	int index;
+
+	for(index = 0; index < count; index++){
+		if(chunk[index] == '\n'){
+			line[lineCount] = 0;
+			strcpy(text, line);
+			lineCount = 0;
+		}
+		else if(chunk[index] >= 0x20 && chunk[index] < 0x7F && lineCount < TEXT_SIZE - 1){
+			line[lineCount++] = chunk[index];
+		}
+	}
+}
+
+int main(int argc, char *argv[]){
+	FILE *in = stdin;
+	int argIndex = 1;
+	int ch;
+
+	if(argIndex < argc && strcmp(argv[argIndex], "-s") == 0){
+		scroll = 1;
+		argIndex++;
+	}
+	if(argIndex < argc){
+		in = fopen(argv[argIndex], "rb");
+		if(in == NULL){
+			perror(argv[argIndex]);
+			return(2);
+		}
+	}
+	setvbuf(in, NULL, _IONBF, 0); // draw as the bytes come in
+	telemReaderInit(&reader, applyRecord, addText);
+	while((ch = getc(in)) != EOF){
+		telemReaderPut(&reader, ch);
+	}
+	telemReaderEnd(&reader);
+	printf("-- %lu frames, %lu lost, %lu bad\n", frames, reader.lost, reader.bad);
+	return(0);
+}
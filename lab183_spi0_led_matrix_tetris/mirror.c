@@ -0,0 +1,84 @@
+/*****************************************************************
+*
+*                          Function mirror.c
+*
+*  delta coded display mirror, see mirror.h
+*
+******************************************************************/
+
+#include "uart0.h"
+#include "telemetry.h"
+#include "mirror.h"
+
+// record and wire size of count columns, COBS adds one byte per 254
+#define MIRROR_WIRE(count) (TELEM_HEADER + 5*(count) + 2 + 1 + 2)
+
+char mirrorOn;
+static unsigned int mirrorImage[MAX_COL]; // latest published frame
+static unsigned int mirrorSent[MAX_COL];  // what the host has
+static unsigned int lastTime;             // of the last record
+static unsigned int fullTime;             // of the last full frame
+static char mirrorFull;                   // send all columns next
+
+// send the whole frame at the next mirrorPoll()
+void mirrorStart(void){
+	mirrorFull = 1;
+}
+
+/*
+ * take a frame of count planes, MAX_COL columns each, call when the
+ * frame is published
+ */
+void mirrorCapture(const unsigned int *planes, int count){
+	int index, plane;
+	unsigned int data;
+
+	if(!mirrorOn){
+		return;
+	}
+	for(index = 0; index < MAX_COL; index++){
+		data = 0;
+		for(plane = 0; plane < count; plane++){
+			data |= planes[plane*MAX_COL + index];
+		}
+		mirrorImage[index] = data;
+	}
+}
+
+/*
+ * send the changed columns if MIRROR_INTERVAL has passed and the
+ * transmit ring has room, now counts display frames
+ */
+void mirrorPoll(unsigned int now){
+	unsigned char data[TELEM_FRAME_SIZE];
+	int index;
+	int count = 0;
+
+	if(!mirrorOn || now - lastTime < MIRROR_INTERVAL){
+		return;
+	}
+	if(now - fullTime >= MIRROR_REFRESH){
+		mirrorFull = 1;
+	}
+	for(index = 0; index < MAX_COL; index++){
+		if(mirrorFull || mirrorImage[index] != mirrorSent[index]){
+			data[count++] = index;
+			data[count++] = mirrorImage[index];
+			data[count++] = mirrorImage[index] >> 8;
+			data[count++] = mirrorImage[index] >> 16;
+			data[count++] = mirrorImage[index] >> 24;
+		}
+	}
+	if(count == 0 || uart0_tx_free() < MIRROR_WIRE(count / 5)){
+		return;
+	}
+	telemSend(TELEM_FRAME, data, count);
+	for(index = 0; index < MAX_COL; index++){
+		mirrorSent[index] = mirrorImage[index];
+	}
+	if(mirrorFull){
+		fullTime = now;
+		mirrorFull = 0;
+	}
+	lastTime = now;
+}
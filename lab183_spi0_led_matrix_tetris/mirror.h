@@ -0,0 +1,34 @@
+/*****************************************************************
+*
+*                          Function mirror.h
+*
+*  mirror of the display over UART0, shown on the host by
+*  matrix_view.c
+*
+*  the latest published frame is kept as one word per column, a
+*  pixel is lit if it is on in any plane, mirrorPoll() sends the
+*  columns that changed since the last record as TELEM_FRAME
+*  (telemetry.h), each as column and word
+*  a full frame is 16 x 5 bytes, 91 on the wire, at 38400 baud
+*  (3840 bytes/s) records are kept MIRROR_INTERVAL apart and only go
+*  out when the transmit ring has room for them, so text is not
+*  dropped, a change that has to wait is sent with the next record
+*
+******************************************************************/
+
+#ifndef __MIRROR_H
+#define __MIRROR_H
+
+#include "tetris.h"
+
+// calls of mirrorPoll() are timed in display frames (8 ms in rev3)
+#define MIRROR_INTERVAL 6 // 20 records/s, half the link at most
+#define MIRROR_REFRESH 125 // all columns every second, a lost record heals
+
+extern char mirrorOn;
+
+void mirrorStart(void);
+void mirrorCapture(const unsigned int *, int);
+void mirrorPoll(unsigned int);
+
+#endif // __MIRROR_H
@@ -0,0 +1,115 @@
+/*****************************************************************
+*
+*                          Function print_bench.c
+*
+*  cost of a formatted line, the C library sprintf() against
+*  fmt_vprint() (format.c), both write to memory so the UART is not
+*  part of the result, the lines are printf() calls of rev3
+*
+*  target: a Keil project with print_bench.c, bench.c, uart0.c,
+*  format.c and hal_lpc2138.c, the results are CPU cycles per call
+*  (bench.h)
+*  code size: build rev3 with UART0_PRINTF 0 and 1 and compare
+*  "Total RO Size" in the map file, or with the GNU tools link an
+*  image that calls only sprintf() and one that calls only
+*  fmt_vprint(), arm-none-eabi-gcc -Os -mcpu=arm7tdmi
+*  --specs=nano.specs --specs=nosys.specs, and compare
+*  arm-none-eabi-size
+*
+*  host: ns per call
+*  gcc -O2 -DHAL_HOST -I../lpc2138_lib -o print_bench
+*      print_bench.c bench.c uart0.c ../lpc2138_lib/format.c
+*      ../lpc2138_lib/hal_host.c
+*
+******************************************************************/
+
+#include <stdio.h>
+#include "hal.h"
+#include "uart0.h"
+#include "format.h"
+#include "bench.h"
+
+#define BENCH_LINES 4
+
+static const char *lineName[BENCH_LINES] = {
+	"seed", "level", "scan", "text"
+};
+
+static char line[64];
+static int lineCount;
+
+static int linePut(int ch){
+	line[lineCount++] = ch;
+	return(ch);
+}
+
+// fmt_vprint() into line
+static int linePrint(const char *format, ...){
+	va_list args;
+	int count;
+
+	lineCount = 0;
+	va_start(args, format);
+	count = fmt_vprint(linePut, format, args);
+	va_end(args);
+	return(count);
+}
+
+// time BENCH_COUNT lines, lite selects fmt_vprint(), return: per call x 10
+unsigned long runLine(int index, int lite){
+	unsigned long begin, end;
+	int count;
+
+	begin = benchNow();
+	for(count = 0; count < BENCH_COUNT; count++){
+		switch(index + (lite ? BENCH_LINES : 0)){
+			case 0:
+				sprintf(line, "Seed: 0x%08x\n", 0x5EED1234 + count);
+				break;
+			case 1:
+				sprintf(line, "Level: %2d\n", count & 0xF);
+				break;
+			case 2:
+				sprintf(line, "Scan: %d planes, %d ticks/ISR max, %d late\n", 4, count, 0);
+				break;
+			case 3:
+				sprintf(line, "%s\n", "Game over");
+				break;
+			case BENCH_LINES + 0:
+				linePrint("Seed: 0x%08x\n", 0x5EED1234 + count);
+				break;
+			case BENCH_LINES + 1:
+				linePrint("Level: %2d\n", count & 0xF);
+				break;
+			case BENCH_LINES + 2:
+				linePrint("Scan: %d planes, %d ticks/ISR max, %d late\n", 4, count, 0);
+				break;
+			case BENCH_LINES + 3:
+				linePrint("%s\n", "Game over");
+				break;
+		}
+	}
+	end = benchNow();
+	return(benchPerCall(begin, end));
+}
+
+int main(void){
+	int index;
+	unsigned long stock, lite;
+
+	benchStart("printf benchmark");
+	for(index = 0; index < BENCH_LINES; index++){
+		stock = runLine(index, 0);
+		lite = runLine(index, 1);
+		uart0_puts("  ");
+		uart0_puts((char *) lineName[index]);
+		uart0_puts(": sprintf ");
+		printTenths(stock);
+		uart0_puts(", fmt_vprint ");
+		printTenths(lite);
+		uart0_puts(" (x");
+		printTenths(lite ? stock * 10 / lite : 0);
+		uart0_puts(")\n");
+	}
+	return(benchEnd());
+}
@@ -0,0 +1,75 @@
+/*****************************************************************
+*
+*                          Function replay.c
+*
+*  the game only changes through tetrisStep(), so the seed and the
+*  order of the calls are enough to play a game again bit for bit
+*  the log is not wrapped once full, a replay needs every step from
+*  the seed on, recording stops and the dump is marked full
+*
+******************************************************************/
+
+#include <stdio.h>
+#include "uart0.h" // printf() may be uart0_printf()
+#include "tetris.h"
+#include "replay.h"
+
+static unsigned char replayData[REPLAY_SIZE];
+static int replayCount;
+static char replayFull;
+static unsigned int replaySeed;
+
+// start an empty record for a game started with seed
+void replayStart(unsigned int seed){
+	replaySeed = seed;
+	replayCount = 0;
+	replayFull = 0;
+}
+
+static void replayPut(unsigned char data){
+	if(replayCount < REPLAY_SIZE){
+		replayData[replayCount++] = data;
+	}
+	else{
+		replayFull = 1;
+	}
+}
+
+/*
+ * record one tetrisStep() call, the same arguments in the same order
+ * runs of gravity ticks share a byte
+ */
+void replayStep(char input, char tick){
+	unsigned char last;
+
+	if(replayFull){
+		return;
+	}
+	if(tick){
+		last = replayCount ? replayData[replayCount - 1] : 0;
+		if((last & REPLAY_TICK) && (last & REPLAY_TICK_MAX) < REPLAY_TICK_MAX){
+			replayData[replayCount - 1]++;
+		}
+		else{
+			replayPut(REPLAY_TICK | 1);
+		}
+	}
+	if(input != CMD_NONE){
+		replayPut(input);
+	}
+}
+
+// print the record and check, the tetrisHash() of the game now
+void replayDump(unsigned int check){
+	int index;
+
+	printf("Replay: seed 0x%08x, %d bytes%s\n", replaySeed, replayCount,
+		replayFull ? ", full" : "");
+	for(index = 0; index < replayCount; index++){
+		printf("%02x", replayData[index]);
+		if((index % REPLAY_LINE) == REPLAY_LINE - 1 || index == replayCount - 1){
+			printf("\n");
+		}
+	}
+	printf("Check: 0x%08x\n", check);
+}
@@ -0,0 +1,31 @@
+/*****************************************************************
+*
+*                          Function replay.h
+*
+*  record of the tetrisStep() calls of one game, dumped over UART0
+*  and played back on the host by tetris_replay.c
+*
+******************************************************************/
+
+#ifndef __REPLAY_H
+#define __REPLAY_H
+
+#define REPLAY_SIZE 4096 // bytes of RAM, about 20 minutes at level 1
+
+// one byte per record
+// 0x01 - 0x06: tetrisStep(game, CMD_xxx, 0)
+// 0x81 - 0xFF: 1 - 127 x tetrisStep(game, CMD_NONE, 1)
+#define REPLAY_TICK 0x80
+#define REPLAY_TICK_MAX 0x7F
+
+// dump format, text so it survives a terminal capture
+// Replay: seed 0x<seed>, <count> bytes[, full]
+// <hex bytes, REPLAY_LINE per line>
+// Check: 0x<tetrisHash() at the time of the dump>
+#define REPLAY_LINE 32
+
+void replayStart(unsigned int);
+void replayStep(char, char);
+void replayDump(unsigned int);
+
+#endif // __REPLAY_H
@@ -6,44 +6,86 @@
 
 // Include Function
 // Include Function
-#include <LPC213X.h>
+#include "hal.h"
+#include "lpc213x_vic.h"
 #include "spi0.h"
 
+#if !DISPLAY_SSP
+
+// interrupt-driven transmit state
+static const unsigned short *spiTxData; // next word to be sent
+static int spiTxCount;                  // words left after the current one
+volatile char spiBusy;                  // 1 while a frame is shifting out
+
 void init_SPI(void)
 {
-	PCONP   |= 0x00000100;   // SPI Interface Enable
-	// set up port function for SPI interface
-	// (1) Clear P0.2-P0.7
-	PINSEL0 &= ~(0xFFF0);
-
-	
-	// (2) Select P0.4 as SCLK, P0.5 as MISO, 
-	//     P0.6 as MOSI, P0.7 as GPIO
-	PINSEL0 |= (1 << 8) | (1 << 10) | (1 << 12);
+	// (1) Select P0.4 as SCLK, P0.5 as MISO, P0.6 as MOSI
+	// (2) 16-bit master, SPI interrupt enabled only while
+	//     write_SPI_frame() is running
+	// (3) SPI clock rate = PCLK/15 ~ 3.67 MHz
+	hal_spi_init(15);
 	
-  // (3) set P0.7 as Output
-	IO0DIR |= STROBE | LATCH;
+  // (4) set P0.3 and P0.7 as Output
+	hal_gpio_output(0, STROBE | LATCH);
 	
-	// (4) set P0.3 and P0.2 as Input
-	
-	// (5) set up S0SPCR using the following settings
-		// BitEnable = 1, 16-bit format
-		// CPHA = 0 = Rising Clock Shift Data,
-		// CPOL = 0 = Normal Clock
-		// MSTR = 1 = Master
-		// LSBF = 0 = MSB First
-		// SPIE = 0 = Disable SPI Interrupt
-	S0SPCR = 0x24;
-
-	S0SPCCR = 15;    // SPI clock rate = PCLK/S0SPCCR ~ 3.67 MHz
-	IO0SET = LATCH; // Set LATCH signal
-	IO0CLR = STROBE; // Enable display 
+	hal_gpio_set(0, LATCH); // Set LATCH signal
+	hal_gpio_clr(0, STROBE); // Enable display 
+	spiBusy = 0;
 }
 
 void write_SPI(unsigned int data)
 {
   // Send SPI
-  S0SPDR = data; // only 8 bit is read                 
+  hal_spi_write(data);
   // Wait SPIF = 1 (SPI Send Complete)
-  while((S0SPSR & 0x80) != 0x80);         
+  while(!hal_spi_done());         
+}
+
+/*
+ * set up VIC for the SPI0 interrupt
+ * vector slot 3 is assigned for SPI0
+ */
+void init_SPI_int(void)
+{
+  hal_irq_install(3, VIC_SPI, spi0IRQ); // vector slot 3 assigned for SPI0
 }
+
+/*
+ * start sending count words from data without waiting
+ * the words are chained by spi0IRQ() and LATCH is pulsed
+ * after the last one, data must stay valid until spiBusy = 0
+ * return: count if the frame was queued, 0 if SPI0 is busy
+ */
+int write_SPI_frame(const unsigned short *data, int count)
+{
+	if(spiBusy || count <= 0){
+		return 0;
+	}
+	spiBusy = 1;
+	spiTxData = data + 1;
+	spiTxCount = count - 1;
+	(void) hal_spi_done(); // read status so the data write clears SPIF
+	hal_spi_write(data[0]);  // send the first word
+	hal_spi_int_enable();    // the rest is sent from the interrupt
+	return count;
+}
+
+__irq void spi0IRQ(void)
+{
+	(void) hal_spi_done(); // read status, first step of clearing SPIF
+	if(spiTxCount > 0){
+		hal_spi_write(*spiTxData++); // send next word, also clears SPIF
+		spiTxCount--;
+	}
+	else{
+		(void) hal_spi_read(); // dummy read to clear SPIF
+		hal_spi_int_disable(); // frame done, no more interrupt
+		hal_gpio_clr(0, LATCH);  // load pulse
+		hal_gpio_set(0, LATCH);
+		spiBusy = 0;
+	}
+	hal_spi_int_clear(); // clear SPI0 interrupt
+	hal_irq_end(); // return interrupt
+}
+
+#endif // !DISPLAY_SSP
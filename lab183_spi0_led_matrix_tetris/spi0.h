@@ -24,6 +24,36 @@
 // P0.7 to STROBE
 #define STROBE 0x00000080       
 
+// display transport, selected at build time
+// 0 = SPI0 (P0.4-P0.6), 1 = SSP (P0.17-P0.19, 8-frame FIFO)
+// with SSP the display SCLK/SI are rewired to SCK1(P0.17)/MOSI1(P0.19),
+// LATCH and STROBE stay on P0.3 and P0.7
+#ifndef DISPLAY_SSP
+#define DISPLAY_SSP 0
+#endif
+
+// S0SPCR / S0SPSR bits
+#define SPIE 0x00000080
+#define SPIF 0x00000080
+
+// SSPSR / SSPIMSC / SSPICR bits
+#define SSP_TFE  0x01
+#define SSP_TNF  0x02
+#define SSP_RNE  0x04
+#define SSP_BSY  0x10
+#define SSP_RTIM 0x02
+#define SSP_RTIC 0x02
+#define SSP_FIFO_SIZE 8
+
+// words per display column frame (upper rows, lower rows, column)
+#define SPI_FRAME_SIZE 3
+
+extern volatile char spiBusy;
+
 // Function Prototype
 void init_SPI(void);
 void write_SPI(unsigned int);
+void init_SPI_int(void);
+int write_SPI_frame(const unsigned short *, int);
+__irq void spi0IRQ(void);
+__irq void sspIRQ(void);
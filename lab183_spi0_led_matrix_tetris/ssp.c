@@ -0,0 +1,122 @@
+/*****************************************************************
+*
+*                          Function ssp.c
+*
+*  SSP (SPI1) display transport, same interface as spi0.c
+*  build with DISPLAY_SSP = 1 in spi0.h
+*  target only, the host backend of hal.h models SPI0
+*
+******************************************************************/
+
+// Include Function
+#include "hal.h"
+#include "lpc213x_vic.h"
+#include "spi0.h"
+
+#if DISPLAY_SSP
+
+#ifdef HAL_HOST
+#error "DISPLAY_SSP is not modelled by the host HAL, use SPI0"
+#endif
+
+volatile char spiBusy; // 1 while a frame is in the FIFO or on the bus
+
+// empty the receive FIFO, MISO data is not used by the display
+static void flush_SSP_rx(void)
+{
+	while(SSPSR & SSP_RNE){
+		(void) SSPDR;
+	}
+}
+
+void init_SPI(void)
+{
+	PCONP   |= 0x00000400;   // SSP Interface Enable
+	// set up port function for SSP interface
+	// (1) Clear P0.17-P0.19
+	PINSEL1 &= ~(0xFC);
+
+	// (2) Select P0.17 as SCK1, P0.18 as MISO1, P0.19 as MOSI1
+	PINSEL1 |= (2 << 2) | (2 << 4) | (2 << 6);
+
+	// (3) set P0.3 (LATCH) and P0.7 (STROBE) as GPIO output
+	PINSEL0 &= ~((3 << 6) | (3 << 14));
+	IO0DIR |= STROBE | LATCH;
+
+	// (4) set up SSPCR0 using the following settings
+		// DSS = 0xF = 16-bit format
+		// FRF = 0 = SPI frame
+		// CPOL = 0 = Normal Clock
+		// CPHA = 0 = Rising Clock Shift Data
+		// SCR = 0
+	SSPCR0 = 0x000F;
+
+	SSPCPSR = 4;     // SSP clock rate = PCLK/SSPCPSR ~ 7.37 MHz
+	SSPIMSC = 0;     // interrupt enabled only while a frame is sent
+
+	// (5) LBM = 0, SSE = 1 = enable, MS = 0 = Master
+	SSPCR1 = 0x02;
+	flush_SSP_rx();
+
+	IO0SET = LATCH; // Set LATCH signal
+	IO0CLR = STROBE; // Enable display
+	spiBusy = 0;
+}
+
+void write_SPI(unsigned int data)
+{
+	// wait for room in the transmit FIFO
+	while(!(SSPSR & SSP_TNF));
+	SSPDR = data;
+	// Wait until the frame is out, the caller latches right after
+	while(SSPSR & SSP_BSY);
+	flush_SSP_rx();
+}
+
+/*
+ * set up VIC for the SSP interrupt
+ * vector slot 3 is assigned for SSP
+ */
+void init_SPI_int(void)
+{
+  VICIntSelect &= ~(1 << VIC_SSP); // use SSP in Vectored IRQ mode
+  VICVectAddr3 = (unsigned int) sspIRQ; // assigned interrupt function
+  VICVectCntl3 = 0x20 | VIC_SSP;  // vector slot 3 assigned for SSP
+  VICIntEnable |= (1 << VIC_SSP); // enable SSP
+}
+
+/*
+ * push count words into the transmit FIFO in one burst
+ * the receive timeout interrupt fires once the bus has been idle,
+ * sspIRQ() then pulses LATCH
+ * return: count if the frame was queued, 0 if busy or too long
+ */
+int write_SPI_frame(const unsigned short *data, int count)
+{
+	int index;
+
+	if(spiBusy || count <= 0 || count > SSP_FIFO_SIZE){
+		return 0;
+	}
+	spiBusy = 1;
+	for(index = 0; index < count; index++){
+		SSPDR = data[index];
+	}
+	SSPIMSC = SSP_RTIM; // receive timeout = all frames shifted out
+	return count;
+}
+
+__irq void sspIRQ(void)
+{
+	flush_SSP_rx();
+	if(!(SSPSR & SSP_BSY) && (SSPSR & SSP_TFE)){
+		SSPIMSC = 0;     // frame done, no more interrupt
+		IO0CLR = LATCH;  // load pulse
+		IO0SET = LATCH;
+		spiBusy = 0;
+	}
+	SSPICR = SSP_RTIC; // clear receive timeout interrupt
+	VICVectAddr = 0; // return interrupt
+}
+
+#endif // DISPLAY_SSP
@@ -0,0 +1,237 @@
+/*****************************************************************
+*
+*                          Function telemetry.c
+*
+*  a record is built, framed and queued on UART0 in a few hundred
+*  cycles, no formatting and no floating point
+*
+******************************************************************/
+
+#include "uart0.h"
+#include "telemetry.h"
+
+char telemOn;
+volatile unsigned int telemTime;
+static unsigned char telemSeq;
+
+/*
+ * CRC-16/CCITT, bit by bit, a record is short
+ */
+unsigned short telemCrc(const unsigned char *data, int count){
+	unsigned int crc = 0xFFFF;
+	int index, bit;
+
+	for(index = 0; index < count; index++){
+		crc ^= data[index] << 8;
+		for(bit = 0; bit < 8; bit++){
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+	return(crc & 0xFFFF);
+}
+
+/*
+ * COBS encode count bytes of data into out, no 0x00 is left
+ * return: bytes written, count + 1 + count/254 at most
+ */
+int telemCobs(const unsigned char *data, int count, unsigned char *out){
+	int index;
+	int code = 0;   // where the length of the current run goes
+	int size = 1;
+
+	for(index = 0; index < count; index++){
+		if(data[index] == 0){
+			out[code] = size - code;
+			code = size++;
+		}
+		else{
+			out[size++] = data[index];
+			if(size - code == 0xFF){
+				out[code] = 0xFF;
+				code = size++;
+			}
+		}
+	}
+	out[code] = size - code;
+	return(size);
+}
+
+/*
+ * undo telemCobs(), for the host tools
+ * return: decoded size, -1 if the data is not COBS
+ */
+int telemUncobs(const unsigned char *data, int count, unsigned char *out){
+	int index = 0;
+	int size = 0;
+	int code, run;
+
+	while(index < count){
+		code = data[index++];
+		if(code == 0 || index + code - 1 > count){
+			return(-1);
+		}
+		for(run = 1; run < code; run++){
+			out[size++] = data[index++];
+		}
+		if(code != 0xFF && index < count){
+			out[size++] = 0;
+		}
+	}
+	return(size);
+}
+
+// frame a record and queue it on UART0, telemOn is checked by the callers
+void telemSend(char type, const unsigned char *payload, int size){
+	unsigned char frame[TELEM_FRAME_MAX];
+	unsigned char wire[TELEM_WIRE_MAX];
+	unsigned int time = telemTime;
+	unsigned short crc;
+	int index, count;
+
+	frame[0] = type;
+	frame[1] = telemSeq++;
+	frame[2] = time;
+	frame[3] = time >> 8;
+	frame[4] = time >> 16;
+	frame[5] = time >> 24;
+	for(index = 0; index < size; index++){
+		frame[TELEM_HEADER + index] = payload[index];
+	}
+	count = TELEM_HEADER + size;
+	crc = telemCrc(frame, count);
+	frame[count++] = crc;
+	frame[count++] = crc >> 8;
+	wire[0] = 0; // ends any text before the record
+	count = telemCobs(frame, count, &wire[1]) + 1;
+	wire[count++] = 0;
+	uart0_write(wire, count);
+}
+
+// events of one tetrisStep() call and where the game is
+void telemEvent(tetrisGame *game, int events){
+	unsigned char data[8];
+
+	if(!telemOn){
+		return;
+	}
+	data[0] = events;
+	data[1] = events >> 8;
+	data[2] = game->currentRow;
+	data[3] = game->currentShape;
+	data[4] = game->objColOffset;
+	data[5] = game->currentLevel;
+	data[6] = game->lineErase;
+	data[7] = game->lineErase >> 8;
+	telemSend(TELEM_EVENT, data, sizeof(data));
+}
+
+void telemCounter(char id, unsigned int value){
+	unsigned char data[5];
+
+	if(!telemOn){
+		return;
+	}
+	data[0] = id;
+	data[1] = value;
+	data[2] = value >> 8;
+	data[3] = value >> 16;
+	data[4] = value >> 24;
+	telemSend(TELEM_COUNTER, data, sizeof(data));
+}
+
+// the board and the falling block
+void telemBoard(tetrisGame *game){
+	unsigned char data[TELEM_BOARD_SIZE];
+	int index;
+
+	if(!telemOn){
+		return;
+	}
+	data[0] = game->currentRow;
+	data[1] = game->currentShape;
+	data[2] = game->objColOffset;
+	for(index = 0; index < MAX_ROW; index++){
+		data[3 + 2*index] = game->boardRow[index];
+		data[4 + 2*index] = game->boardRow[index] >> 8;
+	}
+	telemSend(TELEM_BOARD, data, sizeof(data));
+}
+
+// the events of a tetrisStep() call, the board too once a block merges
+void telemStep(tetrisGame *game, int events){
+	telemEvent(game, events);
+	if(events & EVENT_MERGED){
+		telemBoard(game);
+	}
+}
+
+#ifdef HAL_HOST
+/*********************************************
+ * record reader, host tools
+ *********************************************/
+
+unsigned int telemGet16(const unsigned char *data){
+	return(data[0] | (data[1] << 8));
+}
+
+unsigned int telemGet32(const unsigned char *data){
+	return(data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int) data[3] << 24));
+}
+
+void telemReaderInit(telemReader *reader, void (*record)(const unsigned char *, int, int),
+	void (*text)(const unsigned char *, int)){
+	reader->count = 0;
+	reader->lastSeq = -1;
+	reader->records = 0;
+	reader->lost = 0;
+	reader->bad = 0;
+	reader->record = record;
+	reader->text = text;
+}
+
+// a chunk between two 0x00, a record or text
+static void telemChunk(telemReader *reader){
+	unsigned char frame[TELEM_CHUNK_MAX];
+	int size = telemUncobs(reader->chunk, reader->count, frame);
+	int missed = 0;
+	int index, ch;
+
+	if(size >= TELEM_HEADER + 2 && telemCrc(frame, size - 2) == telemGet16(frame + size - 2)){
+		if(reader->lastSeq >= 0){
+			missed = (frame[1] - reader->lastSeq - 1) & 0xFF;
+		}
+		reader->lastSeq = frame[1];
+		reader->records++;
+		reader->lost += missed;
+		reader->record(frame, size - TELEM_HEADER - 2, missed);
+		return;
+	}
+	// text is printable, anything else was a record with a wrong CRC
+	for(index = 0; index < reader->count; index++){
+		ch = reader->chunk[index];
+		if((ch < 0x20 && ch != '\r' && ch != '\n') || ch >= 0x7F){
+			reader->bad++;
+			return;
+		}
+	}
+	reader->text(reader->chunk, reader->count);
+}
+
+void telemReaderPut(telemReader *reader, int ch){
+	if(ch == 0){
+		telemChunk(reader);
+		reader->count = 0;
+	}
+	else if(reader->count < TELEM_CHUNK_MAX){
+		reader->chunk[reader->count++] = ch;
+	}
+}
+
+// the last chunk, if the capture does not end with 0x00
+void telemReaderEnd(telemReader *reader){
+	if(reader->count){
+		telemChunk(reader);
+		reader->count = 0;
+	}
+}
+#endif
@@ -0,0 +1,82 @@
+/*****************************************************************
+*
+*                          Function telemetry.h
+*
+*  binary telemetry over UART0, decoded on the host by
+*  telemetry_decode.c
+*
+*  record, little endian:
+*  | type | seq | time (4) | payload | CRC (2) |
+*  seq counts the records so the decoder can see a lost one, time is
+*  telemTime, the CRC is CRC-16/CCITT (0x1021, start 0xFFFF) of the
+*  bytes before it
+*  on the wire a record is COBS encoded between two 0x00, text from
+*  printf() can go out between records
+*
+******************************************************************/
+
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+#include "tetris.h"
+
+// record types and their payload
+#define TELEM_EVENT 0x01   // events (2), row, shape, offset, level, lines (2)
+#define TELEM_COUNTER 0x02 // id, value (4)
+#define TELEM_BOARD 0x03   // row, shape, offset, MAX_ROW rows (2 each, bit n = column n)
+#define TELEM_FRAME 0x04   // column, word (4) for each changed display column, mirror.c
+
+#define TELEM_HEADER 6
+#define TELEM_BOARD_SIZE (3 + 2*MAX_ROW)
+#define TELEM_FRAME_SIZE (5*MAX_COL) // all columns
+#define TELEM_PAYLOAD_MAX TELEM_FRAME_SIZE
+#define TELEM_FRAME_MAX (TELEM_HEADER + TELEM_PAYLOAD_MAX + 2)
+// COBS adds one byte per 254 and the delimiters
+#define TELEM_WIRE_MAX (TELEM_FRAME_MAX + TELEM_FRAME_MAX/254 + 3)
+
+// TELEM_COUNTER ids
+#define TELEM_SCAN_TICKS 0 // Timer0 ticks in timer0IRQ(), max
+#define TELEM_SCAN_LATE 1  // planes that found SPI busy
+#define TELEM_RX_DROPPED 2 // UART0 receive ring overflow
+#define TELEM_TX_DROPPED 3 // UART0 transmit ring overflow
+#define TELEM_COUNTERS 4
+
+extern char telemOn;               // send the event, counter and board records
+extern volatile unsigned int telemTime; // time stamp, kept by the program
+
+void telemSend(char, const unsigned char *, int);
+void telemEvent(tetrisGame *, int);
+void telemCounter(char, unsigned int);
+void telemBoard(tetrisGame *);
+void telemStep(tetrisGame *, int);
+unsigned short telemCrc(const unsigned char *, int);
+int telemCobs(const unsigned char *, int, unsigned char *);
+int telemUncobs(const unsigned char *, int, unsigned char *);
+
+#ifdef HAL_HOST
+/*
+ * record reader of the host tools, the capture goes in a byte at a
+ * time, each chunk between two 0x00 comes out as a record with a
+ * good CRC, as text or, if it is neither, is counted as bad
+ */
+#define TELEM_CHUNK_MAX 1024
+
+typedef struct {
+	unsigned char chunk[TELEM_CHUNK_MAX];
+	int count;
+	int lastSeq; // -1 before the first record
+	unsigned long records, lost, bad;
+	// frame, payload size, records lost just before it
+	void (*record)(const unsigned char *, int, int);
+	void (*text)(const unsigned char *, int);
+} telemReader;
+
+void telemReaderInit(telemReader *, void (*)(const unsigned char *, int, int),
+	void (*)(const unsigned char *, int));
+void telemReaderPut(telemReader *, int);
+void telemReaderEnd(telemReader *);
+unsigned int telemGet16(const unsigned char *);
+unsigned int telemGet32(const unsigned char *);
+#endif
+
+#endif // __TELEMETRY_H
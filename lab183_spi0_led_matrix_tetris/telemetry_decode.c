@@ -0,0 +1,161 @@
+/*****************************************************************
+*
+*                          Function telemetry_decode.c
+*
+*  decodes a UART0 capture with telemetry records (telemetry.h) on
+*  the host, text between the records is passed through
+*
+*  gcc -O2 -DHAL_HOST -I../lpc2138_lib -o telemetry_decode
+*      telemetry_decode.c telemetry.c uart0.c ../lpc2138_lib/format.c
+*      ../lpc2138_lib/hal_host.c
+*  ./telemetry_decode [-c] [file]
+*    -c     CSV, one line per record: time,seq,type,fields
+*  matrix_view.c shows the frame records as a picture
+*    file   raw capture, standard input if not given
+*
+******************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "telemetry.h"
+
+static const char *eventName[] = {
+	"moved", "new block", "merged", "lines", "level up", "game over"
+};
+static const char *counterName[TELEM_COUNTERS] = {
+	"scan ticks", "scan late", "rx dropped", "tx dropped"
+};
+
+static int csv;
+
+static void printRecord(const unsigned char *frame, int size, int missed){
+	const unsigned char *data = frame + TELEM_HEADER;
+	unsigned int time = telemGet32(frame + 2);
+	int seq = frame[1];
+	int index, col, events;
+
+	if(missed && !csv){
+		printf("-- %d records lost\n", missed);
+	}
+
+	switch(frame[0]){
+		case TELEM_EVENT:
+			if(size < 8){
+				break;
+			}
+			events = telemGet16(data);
+			if(csv){
+				printf("%u,%d,event,0x%02x,%d,%d,%d,%d,%u\n", time, seq, events,
+					data[2], data[3], (signed char) data[4], data[5], telemGet16(data + 6));
+				return;
+			}
+			printf("%10u event  row %2d shape %2d offset %3d level %d lines %u:",
+				time, data[2], data[3], (signed char) data[4], data[5], telemGet16(data + 6));
+			for(index = 0; index < 6; index++){
+				if(events & (1 << index)){
+					printf(" %s", eventName[index]);
+				}
+			}
+			printf("\n");
+			return;
+		case TELEM_COUNTER:
+			if(size < 5){
+				break;
+			}
+			if(csv){
+				printf("%u,%d,counter,%d,%u\n", time, seq, data[0], telemGet32(data + 1));
+				return;
+			}
+			printf("%10u counter %s: %u\n", time,
+				data[0] < TELEM_COUNTERS ? counterName[data[0]] : "?", telemGet32(data + 1));
+			return;
+		case TELEM_BOARD:
+			if(size < TELEM_BOARD_SIZE){
+				break;
+			}
+			if(csv){
+				printf("%u,%d,board,%d,%d,%d", time, seq, data[0], data[1], (signed char) data[2]);
+				for(index = 0; index < MAX_ROW; index++){
+					printf(",0x%04x", telemGet16(data + 3 + 2*index));
+				}
+				printf("\n");
+				return;
+			}
+			printf("%10u board  row %2d shape %2d offset %3d\n", time, data[0], data[1],
+				(signed char) data[2]);
+			for(index = 0; index < MAX_ROW; index++){
+				if(telemGet16(data + 3 + 2*index) == 0){
+					continue; // only the filled rows
+				}
+				printf("%10s %2d |", "", index);
+				for(col = 0; col < MAX_COL; col++){
+					putchar(telemGet16(data + 3 + 2*index) & (1 << col) ? '#' : '.');
+				}
+				printf("|\n");
+			}
+			return;
+		case TELEM_FRAME:
+			if(size % 5){
+				break;
+			}
+			if(csv){
+				printf("%u,%d,frame", time, seq);
+				for(index = 0; index < size; index += 5){
+					printf(",%d,0x%08x", data[index], telemGet32(data + index + 1));
+				}
+				printf("\n");
+				return;
+			}
+			printf("%10u frame  %d columns:", time, size / 5);
+			for(index = 0; index < size; index += 5){
+				printf(" %d", data[index]);
+			}
+			printf("\n");
+			return;
+	}
+	if(!csv){
+		printf("%10u record type %d, %d bytes\n", time, frame[0], size);
+	}
+}
+
+// text between the records
+static void printText(const unsigned char *chunk, int count){
+	int index;
+
+	if(csv){
+		return;
+	}
+	for(index = 0; index < count; index++){
+		if(chunk[index] != '\r'){
+			putchar(chunk[index]);
+		}
+	}
+}
+
+int main(int argc, char *argv[]){
+	telemReader reader;
+	FILE *in = stdin;
+	int argIndex = 1;
+	int ch;
+
+	if(argIndex < argc && strcmp(argv[argIndex], "-c") == 0){
+		csv = 1;
+		argIndex++;
+	}
+	if(argIndex < argc){
+		in = fopen(argv[argIndex], "rb");
+		if(in == NULL){
+			perror(argv[argIndex]);
+			return(2);
+		}
+	}
+	telemReaderInit(&reader, printRecord, printText);
+	while((ch = getc(in)) != EOF){
+		telemReaderPut(&reader, ch);
+	}
+	telemReaderEnd(&reader);
+	if(!csv){
+		printf("-- %lu records, %lu lost, %lu bad\n", reader.records, reader.lost, reader.bad);
+	}
+	return(reader.bad ? 1 : 0);
+}
@@ -0,0 +1,594 @@
+/*****************************************************************
+*
+*                          Function tetris.c
+*
+******************************************************************/
+
+#include "tetris.h"
+
+const unsigned short blockData[BLOCK_SHAPE*BLOCK_VAR] = {
+	 // shape O
+	 0x0660, 0x0660, 0x0660, 0x0660,
+	 // shape +
+	 0x04E4, 0x04E4, 0x04E4, 0x04E4,
+	 // I shape
+	 0x0F00, 0x4444, 0x0F00, 0x4444,
+	 // L shape
+	 0x0E80, 0xC440, 0x2E00, 0x4460,
+	 // J shape
+	 0x0E20, 0x44C0, 0x8E00, 0x6440,
+	 // shape A
+	 0x0E40, 0x4C40, 0x4E00, 0x4640,
+	 // shape B
+	 0x06C0, 0x8C40, 0x06C0, 0x8C40,
+	 // shape C
+	 0x0C60, 0x2640, 0x0C60, 0x2640
+	};
+
+// column offsets tried in order when a rotation does not fit
+const signed char blockKick[BLOCK_KICKS] = {0, -1, 1, -2, 2};
+
+// kicks tried per shape, O and + always rotate onto themselves
+const unsigned char blockKickCount[BLOCK_SHAPE] = {1, 1, 5, 3, 3, 3, 3, 3};
+
+/*
+ * expand shape into BLOCK_SIZE rows, bit n = column n
+ */
+void blockRows(int shape, unsigned short *rows){
+	int index;
+	unsigned int data = blockData[shape];
+	
+	for(index = 0; index < BLOCK_SIZE; index++){
+		rows[index] = (data & BLOCK_ROW_MASK) << BLOCK_COL;
+		data >>= BLOCK_SIZE;
+	}
+}
+
+/*
+ * expand shape into MAX_COL columns, bit n = row n
+ */
+void blockColumns(int shape, unsigned int *cols){
+	int index, rowIndex;
+	unsigned int data = blockData[shape];
+	unsigned int col;
+	
+	for(index = 0; index < MAX_COL; index++){
+		cols[index] = 0;
+	}
+	for(index = 0; index < BLOCK_SIZE; index++){
+		col = 0;
+		for(rowIndex = 0; rowIndex < BLOCK_SIZE; rowIndex++){
+			col |= ((data >> (rowIndex*BLOCK_SIZE + index)) & 0x1) << rowIndex;
+		}
+		cols[BLOCK_COL + index] = col;
+	}
+}
+
+#define RANDOM_SEED 0x2545F491 // used for seed 0, xorshift32 never leaves 0
+
+// xorshift32, period 2^32 - 1
+unsigned int randomNext(unsigned int *state){
+	unsigned int data = *state;
+	
+	data ^= data << 13;
+	data ^= data >> 17;
+	data ^= data << 5;
+	*state = data;
+	return(data);
+}
+
+/*
+ * random number from 0 to range - 1, range <= 0x10000
+ * scaled with a multiply, the ARM7TDMI has no divide
+ */
+unsigned int randomRange(unsigned int *state, unsigned int range){
+	return(((randomNext(state) >> 16) * range) >> 16);
+}
+
+/*********************************************
+ * game core, all state is in tetrisGame
+ *********************************************/
+
+/*
+ * deal the next piece from the bag, refill and shuffle (Fisher-Yates)
+ * once all BLOCK_SHAPE pieces have been dealt
+ */
+static char bagNext(tetrisGame *game){
+	int index, swap;
+	char temp;
+	
+	if(game->bagCount == 0){
+		for(index = 0; index < BLOCK_SHAPE; index++){
+			game->bag[index] = index << 2;
+		}
+		for(index = BLOCK_SHAPE - 1; index > 0; index--){
+			swap = randomRange(&game->randomState, index + 1);
+			temp = game->bag[index];
+			game->bag[index] = game->bag[swap];
+			game->bag[swap] = temp;
+		}
+		game->bagCount = BLOCK_SHAPE;
+	}
+	game->bagCount--;
+	return(game->bag[game->bagCount]);
+}
+
+/*
+ * transpose count rows (bit n = column n) starting at board row top
+ * into column words (bit n = row n)
+ */
+static void rowsToColumns(const unsigned short *rows, int count, int top, unsigned int *cols){
+	int index, colIndex;
+	unsigned int data;
+	
+	for(colIndex = 0; colIndex < MAX_COL; colIndex++){
+		cols[colIndex] = 0;
+	}
+	for(index = 0; index < count; index++){
+		data = rows[index];
+		for(colIndex = 0; data; colIndex++){
+			if(data & 0x1){
+				cols[colIndex] |= 1 << (top + index);
+			}
+			data >>= 1;
+		}
+	}
+}
+
+// column view of the falling block for the display
+static void blockToColumns(tetrisGame *game){
+	rowsToColumns(game->blockRow, BLOCK_SIZE, game->currentRow - BASE_ROW, game->myBlock);
+}
+
+// column view of the board for the display, rebuilt after a line clear
+static void boardToColumns(tetrisGame *game){
+	rowsToColumns(game->boardRow, MAX_ROW, 0, game->bgImage);
+}
+
+/*
+ * build the rows of shape, moved by offset columns, into rows
+ * return: 1 if part of the shape falls outside the side walls
+ */
+static int loadBlockRows(char shape, signed char offset, unsigned short *rows){
+	int index;
+	int clipped = 0;
+	unsigned int data;
+	
+	blockRows(shape, rows);
+	for(index = 0; index < BLOCK_SIZE; index++){
+		if(offset >= 0){
+			data = (unsigned int)rows[index] << offset;
+			clipped |= (data & ~DATA_MASK) != 0;
+		}
+		else{
+			data = rows[index] >> -offset;
+			clipped |= (data << -offset) != rows[index];
+		}
+		rows[index] = data & DATA_MASK;
+	}
+	return(clipped);
+}
+
+/*
+ * test rows placed at board row top against the board
+ * return: 1 if they fit, 0 if they hit the bottom or the background
+ */
+static int blockFits(tetrisGame *game, const unsigned short *rows, int top){
+	int index;
+	
+	for(index = 0; index < BLOCK_SIZE; index++){
+		if(rows[index]){
+			if(top + index >= MAX_ROW || (game->boardRow[top + index] & rows[index])){
+				return(0);
+			}
+		}
+	}
+	return(1);
+}
+
+// bit index for the de Bruijn product of a single set bit
+static const unsigned char deBruijnBit[32] = {
+	0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+	31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+};
+// lowest row of each 4-row block column pattern
+static const unsigned char nibbleBottom[1 << BLOCK_SIZE] = {
+	0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3
+};
+
+/*
+ * index of the lowest set bit of data (data != 0), the ARM7TDMI has
+ * no CLZ so it is looked up from the de Bruijn product
+ */
+static int lowestBit(unsigned int data){
+	return(deBruijnBit[((data & -data) * 0x077CB531U) >> 27]);
+}
+
+// rebuild the skyline from bgImage, after a line clear
+static void updateSkyline(tetrisGame *game){
+	int index;
+	
+	for(index = 0; index < MAX_COL; index++){
+		game->skyline[index] = game->bgImage[index] ? lowestBit(game->bgImage[index]) : MAX_ROW;
+	}
+}
+
+static void newShape(tetrisGame *game){
+	// take the next piece and refill its queue slot from the bag
+	game->currentShape = game->blockList[game->blockListIndex];
+	game->blockList[game->blockListIndex] = bagNext(game);
+	game->blockListIndex = (game->blockListIndex + 1) & (BLOCK_LIST_COUNT - 1);
+	game->currentShapeVar = 0;
+	game->currentRow = BASE_ROW;
+	game->newShapeFlag = 0;
+	game->objColOffset = 0;
+	loadBlockRows(game->currentShape, game->objColOffset, game->blockRow);
+	blockToColumns(game);
+}
+
+// merge the block into the board, its column view and the skyline
+void tetrisMergeData(tetrisGame *game){
+	int index;
+	int top = game->currentRow - BASE_ROW;
+	
+	for(index = 0; index < BLOCK_SIZE; index++){
+		if(game->blockRow[index]){
+			game->boardRow[top + index] |= game->blockRow[index];
+		}
+	}
+	for(index = 0; index < MAX_COL; index++){
+		if(game->myBlock[index]){
+			game->bgImage[index] = game->bgImage[index] | game->myBlock[index];
+			game->skyline[index] = lowestBit(game->bgImage[index]);
+		}
+	}
+}
+
+/*
+ * test the block one row down
+ * return: 0 if it can move, 0x100 if it is on the bottom,
+ * otherwise the row above the topmost hit (at least BASE_ROW)
+ */
+static int collisionTest(tetrisGame *game){
+	int index, row;
+	int top = game->currentRow - BASE_ROW + 1;
+	int result = 0;
+	
+	for(index = 0; index < BLOCK_SIZE; index++){
+		if(game->blockRow[index]){
+			row = top + index;
+			if(row >= MAX_ROW){
+				result = 0x100; // end of column
+				break;
+			}
+			if(game->boardRow[row] & game->blockRow[index]){
+				result = row - 1; // return result
+				if(result < BASE_ROW){
+					result = BASE_ROW; // no room to merge, game over
+				}
+				break;
+			}
+		}
+	}
+	if(result){
+		game->newShapeFlag = 1;
+	}
+	return (result);
+}
+
+/*
+ * move the block one column, direction -1 = left, 1 = right
+ * return: 1 if moved
+ */
+static int moveBlock(tetrisGame *game, int direction){
+	int index;
+	unsigned short tempRow[BLOCK_SIZE];
+	unsigned int edge = 0;
+	
+	for(index = 0; index < BLOCK_SIZE; index++){
+		edge |= game->blockRow[index];
+		tempRow[index] = direction < 0 ? game->blockRow[index] >> 1 : game->blockRow[index] << 1;
+	}
+	// valid move
+	if(!(edge & (direction < 0 ? 0x1 : 1 << (MAX_COL - 1))) &&
+		 blockFits(game, tempRow, game->currentRow - BASE_ROW)){
+		for(index = 0; index < BLOCK_SIZE; index++){
+			game->blockRow[index] = tempRow[index];
+		}
+		game->objColOffset += direction;
+		blockToColumns(game);
+		return(1);
+	}
+	return(0);
+}
+
+/*
+ * check for the full rows, only the rows of the merged block can be full
+ * return: bit n set if row n is full
+ */
+int tetrisClearRow(tetrisGame *game){
+	int result = 0;
+	int index, row;
+	int top = game->currentRow - BASE_ROW;
+	
+	for(index = 0; index < BLOCK_SIZE; index++){
+		row = top + index;
+		if(game->blockRow[index] && game->boardRow[row] == DATA_MASK){
+			game->lineErase++; // increase line count
+			result |= 1 << row;
+		}
+	}
+	return(result);
+}
+
+/*
+ * remove the full rows in data with one compaction pass from the
+ * lowest full row up, then rebuild the column view and the skyline
+ */
+void tetrisMergeDown(tetrisGame *game, int data){
+	int index, dest;
+	
+	for(dest = MAX_ROW - 1; dest >= 0 && !(data & (1 << dest)); dest--);
+	for(index = dest - 1; index >= 0; index--){
+		if(data & (1 << index)){
+			continue;
+		}
+		game->boardRow[dest--] = game->boardRow[index];
+	}
+	while(dest >= 0){
+		game->boardRow[dest--] = 0;
+	}
+	boardToColumns(game);
+	updateSkyline(game);
+}
+
+/*
+ * rotate the block by step (ROTATE_CW, ROTATE_180, ROTATE_CCW)
+ * the new state is tried at the kicks of its shape in order, each
+ * try is a 4-row compare against the board
+ * return: 1 if rotated, 0 if no kick fits
+ */
+static int rotateBlock(tetrisGame *game, char step){
+	int index, kick;
+	char tempShape;
+	signed char tempOffset;
+	unsigned short tempRow[BLOCK_SIZE];
+	
+	tempShape = (game->currentShape & ~0x3) | ((game->currentShape + step) & 0x3);
+	for(kick = 0; kick < blockKickCount[game->currentShape >> 2]; kick++){
+		tempOffset = game->objColOffset + blockKick[kick];
+		// skip kicks that push the block through a wall
+		if(!loadBlockRows(tempShape, tempOffset, tempRow) &&
+			 blockFits(game, tempRow, game->currentRow - BASE_ROW)){
+			game->currentShape = tempShape;
+			game->currentShapeVar = tempShape & 0x3;
+			game->objColOffset = tempOffset;
+			for(index = 0; index < BLOCK_SIZE; index++){
+				game->blockRow[index] = tempRow[index];
+			}
+			blockToColumns(game);
+			return(1);
+		}
+	}
+	return(0);
+}
+
+/*
+ * rows the block can fall, one subtraction per block column
+ * falls back to testing row by row if the block is under an overhang
+ */
+int tetrisDropDistance(tetrisGame *game){
+	int index, bottom, fall;
+	int top = game->currentRow - BASE_ROW;
+	int result = MAX_ROW;
+	
+	for(index = 0; index < MAX_COL; index++){
+		if(game->myBlock[index]){
+			bottom = top + nibbleBottom[(game->myBlock[index] >> top) & BLOCK_ROW_MASK];
+			fall = game->skyline[index] - 1 - bottom;
+			if(fall < 0){
+				for(result = 0; blockFits(game, game->blockRow, top + result + 1); result++);
+				return(result);
+			}
+			if(fall < result){
+				result = fall;
+			}
+		}
+	}
+	if(result == MAX_ROW){
+		result = 0; // no block yet
+	}
+	return(result);
+}
+
+static int dropDown(tetrisGame *game){
+	int index;
+	int dropMax = tetrisDropDistance(game);
+	
+	game->currentRow = game->currentRow + dropMax;
+	for(index = 0; index < MAX_COL; index++){
+		game->myBlock[index] = game->myBlock[index] << dropMax;
+	}
+	
+	return dropMax;
+}
+
+/*
+ * start a game with an empty board, the piece sequence is given by
+ * seed, the same seed gives the same pieces
+ */
+void tetrisInit(tetrisGame *game, unsigned int seed){
+	int index;
+	
+	for(index = 0; index < MAX_COL; index++){
+		game->bgImage[index] = 0;
+		game->myBlock[index] = 0;
+		game->skyline[index] = MAX_ROW;
+	}
+	for(index = 0; index < MAX_ROW; index++){
+		game->boardRow[index] = 0;
+	}
+	for(index = 0; index < BLOCK_SIZE; index++){
+		game->blockRow[index] = 0;
+	}
+	game->currentRow = BASE_ROW;
+	game->currentShape = 0;
+	game->currentShapeVar = 0;
+	game->objColOffset = 0;
+	game->currentLevel = 1;
+	game->lineErase = 0;
+	game->newShapeFlag = 1;
+	game->endGameFlag = 0;
+	game->showBlock = 0;
+	game->seed = seed;
+	game->randomState = seed ? seed : RANDOM_SEED;
+	game->bagCount = 0;
+	game->blockListIndex = 0;
+	for(index = 0; index < BLOCK_LIST_COUNT; index++){
+		game->blockList[index] = bagNext(game);
+	}
+}
+
+/*
+ * replace the board with MAX_ROW rows (bit n = column n), for test
+ * positions, the falling block is not checked against it
+ */
+void tetrisLoadBoard(tetrisGame *game, const unsigned short *rows){
+	int index;
+	
+	for(index = 0; index < MAX_ROW; index++){
+		game->boardRow[index] = rows[index] & DATA_MASK;
+	}
+	boardToColumns(game);
+	updateSkyline(game);
+}
+
+// FNV-1a step
+#define HASH_PRIME 0x01000193
+#define HASH_BASIS 0x811C9DC5
+#define hashByte(hash, data) (((hash) ^ ((data) & 0xFF)) * HASH_PRIME)
+
+/*
+ * hash of the board, the block, the counters and the piece generator
+ * two games that took the same steps from the same seed hash the same
+ */
+unsigned int tetrisHash(tetrisGame *game){
+	int index;
+	unsigned int hash = HASH_BASIS;
+	
+	for(index = 0; index < MAX_ROW; index++){
+		hash = hashByte(hash, game->boardRow[index]);
+		hash = hashByte(hash, game->boardRow[index] >> 8);
+	}
+	for(index = 0; index < BLOCK_SIZE; index++){
+		hash = hashByte(hash, game->blockRow[index]);
+		hash = hashByte(hash, game->blockRow[index] >> 8);
+	}
+	hash = hashByte(hash, game->currentRow);
+	hash = hashByte(hash, game->currentShape);
+	hash = hashByte(hash, game->objColOffset);
+	hash = hashByte(hash, game->currentLevel);
+	hash = hashByte(hash, game->lineErase);
+	hash = hashByte(hash, game->lineErase >> 8);
+	hash = hashByte(hash, game->newShapeFlag);
+	hash = hashByte(hash, game->endGameFlag);
+	for(index = 0; index < 32; index += 8){
+		hash = hashByte(hash, game->randomState >> index);
+	}
+	return(hash);
+}
+
+/*
+ * advance the game by one input (CMD_xxx) and, if tick, one row of
+ * gravity, tick is applied first
+ * input is ignored while there is no falling block
+ * return: EVENT_xxx flags
+ */
+int tetrisStep(tetrisGame *game, char input, char tick){
+	int index, collisionRow, rows;
+	int result = 0;
+	
+	if(game->endGameFlag){
+		return(0);
+	}
+	if(tick){
+		if(game->newShapeFlag){
+			newShape(game); // generate new block
+			game->showBlock = 1;
+			result |= EVENT_NEW_BLOCK;
+		}
+		else{
+			// test collision if move down
+			collisionRow = collisionTest(game);
+			// merge background with the block if collision or reach bottom
+			if(collisionRow > BASE_ROW){
+				tetrisMergeData(game); // merge the block into the background
+				game->showBlock = 0;
+				result |= EVENT_MERGED;
+				rows = tetrisClearRow(game);
+				if(rows){
+					tetrisMergeDown(game, rows);
+					result |= EVENT_LINES;
+					if(game->lineErase >= ((game->currentLevel + 1)*LEVEL_LIMIT)){
+						game->currentLevel++;
+						result |= EVENT_LEVEL_UP;
+					}
+				}
+				// check if the background grew over base row
+				if(collisionRow <= BASE_ROW + 2){
+					for(index = 0; index <= BASE_ROW; index++){
+						if(game->boardRow[index]){
+							game->endGameFlag = 1;
+							game->newShapeFlag = 0;
+							result |= EVENT_GAME_OVER;
+							break;
+						}
+					}
+				}
+			}
+			else if(collisionRow == BASE_ROW){
+				game->newShapeFlag = 0;
+				game->endGameFlag = 1;
+				result |= EVENT_GAME_OVER;
+			}
+			// no collision detected just move down the block
+			else{
+				game->currentRow++; // move the block down
+				for(index = 0; index < MAX_COL; index++){
+					game->myBlock[index] = game->myBlock[index] << 1;
+				}
+				result |= EVENT_MOVED;
+			}
+		}
+	}
+	if(game->newShapeFlag || game->endGameFlag){
+		return(result);
+	}
+	switch(input){
+		case CMD_LEFT:
+			index = moveBlock(game, -1);
+			break;
+		case CMD_RIGHT:
+			index = moveBlock(game, 1);
+			break;
+		case CMD_ROTATE_CW:
+			index = rotateBlock(game, ROTATE_CW);
+			break;
+		case CMD_ROTATE_CCW:
+			index = rotateBlock(game, ROTATE_CCW);
+			break;
+		case CMD_ROTATE_180:
+			index = rotateBlock(game, ROTATE_180);
+			break;
+		case CMD_DROP:
+			index = dropDown(game);
+			break;
+		default:
+			index = 0;
+			break;
+	}
+	if(index){
+		result |= EVENT_MOVED;
+	}
+	return(result);
+}
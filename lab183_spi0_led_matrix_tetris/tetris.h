@@ -7,47 +7,87 @@
 #define BLOCK_SIZE 4
 #define BLOCK_VAR 4
 #define CENTER_COL (MAX_COL/2)
+#define BLOCK_COL 6 // left column of the 4x4 block box
+#define BLOCK_ROW_MASK ((1 << BLOCK_SIZE) - 1)
+#define BLOCK_KICKS 5
+#define BASE_ROW 2 // rows above the block box, a block that merges there ends the game
+#define DATA_MASK 0xFFFF
+#define LEVEL_LIMIT 5 // lines per level
+#define BLOCK_LIST_COUNT 4 // lookahead queue, power of 2
+
+// rotation steps, added to the rotation state in the low 2 bits of a shape
+#define ROTATE_CW 1
+#define ROTATE_180 2
+#define ROTATE_CCW 3
+
+// tetrisStep() input
+#define CMD_NONE 0
+#define CMD_LEFT 1
+#define CMD_RIGHT 2
+#define CMD_ROTATE_CW 3
+#define CMD_DROP 4
+#define CMD_ROTATE_CCW 5
+#define CMD_ROTATE_180 6
+
+// tetrisStep() result
+#define EVENT_MOVED 0x01     // the block moved, fell or rotated
+#define EVENT_NEW_BLOCK 0x02 // a block was taken from the queue
+#define EVENT_MERGED 0x04    // the block became part of the board
+#define EVENT_LINES 0x08     // full rows were removed
+#define EVENT_LEVEL_UP 0x10
+#define EVENT_GAME_OVER 0x20 // with EVENT_MERGED: the board reached BASE_ROW
+
+/*
+ * state of one game, no hardware, so it runs on the target or on
+ * the host (tetris_sim.c)
+ * the game works on rows (bit n = column n, row 0 on top),
+ * bgImage and myBlock are the column views used by the display
+ */
+typedef struct {
+	unsigned short boardRow[MAX_ROW];
+	unsigned short blockRow[BLOCK_SIZE]; // block rows from currentRow - BASE_ROW
+	unsigned char skyline[MAX_COL]; // top filled row of each column, MAX_ROW if empty
+	unsigned int bgImage[MAX_COL];
+	unsigned int myBlock[MAX_COL];
+	int currentRow;
+	char currentShape;
+	char currentShapeVar;
+	signed char objColOffset;
+	char currentLevel;
+	int lineErase;
+	char newShapeFlag;
+	char endGameFlag;
+	char showBlock; // myBlock is part of the picture
+	// lookahead queue, blockList[blockListIndex] is the next piece
+	char blockList[BLOCK_LIST_COUNT];
+	unsigned char blockListIndex;
+	// shuffled bag of one piece per shape, dealt from the end
+	char bag[BLOCK_SHAPE];
+	unsigned char bagCount;
+	unsigned int seed;
+	unsigned int randomState; // xorshift32, never 0
+} tetrisGame;
+
+/*
+ * one 4x4 mask per shape and rotation, placed in flash
+ * nibble r = block row r (top first), bit c = column BLOCK_COL + c
+ */
+extern const unsigned short blockData[BLOCK_SHAPE*BLOCK_VAR];
+extern const signed char blockKick[BLOCK_KICKS];
+extern const unsigned char blockKickCount[BLOCK_SHAPE];
+
+void blockRows(int, unsigned short *);
+void blockColumns(int, unsigned int *);
+unsigned int randomNext(unsigned int *);
+unsigned int randomRange(unsigned int *, unsigned int);
+void tetrisInit(tetrisGame *, unsigned int);
+int tetrisStep(tetrisGame *, char, char);
+int tetrisDropDistance(tetrisGame *);
+void tetrisLoadBoard(tetrisGame *, const unsigned short *);
+unsigned int tetrisHash(tetrisGame *);
+// merge steps of tetrisStep(), timed one by one by tetris_bench.c
+void tetrisMergeData(tetrisGame *);
+int tetrisClearRow(tetrisGame *);
+void tetrisMergeDown(tetrisGame *, int);
 
-unsigned int blockData[BLOCK_SHAPE*4][MAX_COL] = 
-	{0,0,0,0,0,0,0x0,0x6,0x6,0x0,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0x6,0x6,0x0,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0x6,0x6,0x0,0,0,0,0,0,0,
-   0,0,0,0,0,0,0x0,0x6,0x6,0x0,0,0,0,0,0,0,
-   // shape +
-   0,0,0,0,0,0,0x0,0x2,0x7,0x2,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0x2,0x7,0x2,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0x2,0x7,0x2,0,0,0,0,0,0,		
-	 0,0,0,0,0,0,0x0,0x2,0x7,0x2,0,0,0,0,0,0,
-	 // I shape		
-	 0,0,0,0,0,0,0x4,0x4,0x4,0x4,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0x0,0xF,0x0,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x4,0x4,0x4,0x4,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0x0,0xF,0x0,0,0,0,0,0,0,
-	 // L shape
-	 0,0,0,0,0,0,0x0,0x4,0x4,0x6,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0x0,0xE,0x8,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0xC,0x4,0x4,0,0,0,0,0,0,
-   0,0,0,0,0,0,0x0,0x2,0xE,0x0,0,0,0,0,0,0,
-   // J shape	
-	 0,0,0,0,0,0,0x0,0x6,0x4,0x4,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0x0,0xE,0x2,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0x4,0x4,0xC,0,0,0,0,0,0,
-   0,0,0,0,0,0,0x0,0x8,0xE,0x0,0,0,0,0,0,0,
-   // shape A
-	 0,0,0,0,0,0,0x0,0x4,0x6,0x4,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0x0,0xE,0x4,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0x4,0xC,0x4,0,0,0,0,0,0,
-   0,0,0,0,0,0,0x0,0x4,0xE,0x0,0,0,0,0,0,0,
-   // shape B
-	 0,0,0,0,0,0,0x0,0x4,0x6,0x2,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0x0,0x6,0xC,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0x4,0x6,0x2,0,0,0,0,0,0,
-   0,0,0,0,0,0,0x0,0x0,0x6,0xC,0,0,0,0,0,0,
-   // shape C
-	 0,0,0,0,0,0,0x0,0x2,0x6,0x4,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0xC,0x6,0x0,0,0,0,0,0,0,
-	 0,0,0,0,0,0,0x0,0x2,0x6,0x4,0,0,0,0,0,0,
-   0,0,0,0,0,0,0x0,0xC,0x6,0x0,0,0,0,0,0,0
-	};
-	
 #endif
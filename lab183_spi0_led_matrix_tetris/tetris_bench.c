@@ -0,0 +1,184 @@
+/*****************************************************************
+*
+*                          Function tetris_bench.c
+*
+*  benchmark of the game core primitives and the frame compose
+*  loops on board fixtures, results go out through uart0_puts()
+*
+*  target: a Keil project with tetris_bench.c, bench.c, tetris.c,
+*  frame.c, uart0.c, format.c and hal_lpc2138.c, the results are CPU
+*  cycles per call (bench.h) and the share of one display column
+*  period of rev3 (2 kHz)
+*
+*  host: ns per call
+*  gcc -O2 -DHAL_HOST -I../lpc2138_lib -o tetris_bench
+*      tetris_bench.c bench.c tetris.c frame.c uart0.c
+*      ../lpc2138_lib/format.c ../lpc2138_lib/hal_host.c
+*
+*  the merge steps of tetrisStep() and the frame.c builders of rev3
+*  are timed one by one
+*  ops that change the game (tick, drop, merge, merge down) restore
+*  the fixture before every call, the cost of the restore is
+*  measured on its own and taken off
+*
+******************************************************************/
+
+#include "hal.h"
+#include "spi0.h"
+#include "uart0.h"
+#include "tetris.h"
+#include "frame.h"
+#include "bench.h"
+
+#ifndef HAL_HOST
+#define SCAN_PERIOD 15000 // PCLK ticks per column, (T0PR_VALUE+1)*T0MR0_VALUE in rev3
+#endif
+
+#define BENCH_FIXTURES 4
+#define BENCH_OPS 10
+#define SHAPE_I (2 << 2)
+
+typedef struct {
+	char *name;
+	int top;       // first filled row
+	int fullRows;  // rows from the bottom with only the I column open
+} benchFixture;
+
+// filled rows have one hole, so none of them is cleared
+static const benchFixture fixture[BENCH_FIXTURES] = {
+	{"empty", MAX_ROW, 0},
+	{"half full", MAX_ROW/2, 0},
+	{"near game over", BASE_ROW + BLOCK_SIZE, 0},
+	{"multi-line clear", MAX_ROW, BLOCK_SIZE}
+};
+
+tetrisGame start;  // fixture with an I block just spawned
+tetrisGame landed; // fixture with the block on the stack
+tetrisGame merged; // landed after tetrisMergeData()
+int mergedRows;    // full rows of merged, tetrisClearRow()
+tetrisGame work;
+unsigned int dispBuffer[BCM_PLANES][MAX_COL];
+unsigned short scanFrame[MAX_COL][BCM_PLANES][SPI_FRAME_SIZE];
+
+/*
+ * set up start, landed and merged for fixture f
+ * the I block stands upright in column BLOCK_COL + 2, the column left
+ * open in the full rows
+ */
+void loadFixture(const benchFixture *f){
+	unsigned short rows[MAX_ROW];
+	int index;
+
+	for(index = 0; index < MAX_ROW; index++){
+		if(index >= MAX_ROW - f->fullRows){
+			rows[index] = DATA_MASK & ~(1 << (BLOCK_COL + 2));
+		}
+		else if(index >= f->top){
+			rows[index] = DATA_MASK & ~(1 << ((index * 5) & (MAX_COL - 1)));
+		}
+		else{
+			rows[index] = 0;
+		}
+	}
+	tetrisInit(&start, 1);
+	start.blockList[start.blockListIndex] = SHAPE_I;
+	tetrisStep(&start, CMD_NONE, 1);
+	tetrisStep(&start, CMD_ROTATE_CW, 0);
+	tetrisLoadBoard(&start, rows);
+	landed = start;
+	tetrisStep(&landed, CMD_DROP, 0);
+	merged = landed;
+	tetrisMergeData(&merged);
+	work = merged;
+	mergedRows = tetrisClearRow(&work);
+}
+
+// time BENCH_COUNT calls of op, return: time per call in BENCH_UNIT x 10
+unsigned long runOp(int op){
+	unsigned long begin, end;
+	int count;
+
+	work = (op == 6) ? merged : start;
+	begin = benchNow();
+	for(count = 0; count < BENCH_COUNT; count++){
+		switch(op){
+			case 0: // restore only
+				work = landed;
+				break;
+			case 1: // collisionTest() and one row down
+				work = start;
+				tetrisStep(&work, CMD_NONE, 1);
+				break;
+			case 2: // moveLeft() then moveRight()
+				tetrisStep(&work, CMD_LEFT, 0);
+				tetrisStep(&work, CMD_RIGHT, 0);
+				break;
+			case 3: // rotateCW(), the I block turns back every second call
+				tetrisStep(&work, CMD_ROTATE_CW, 0);
+				break;
+			case 4: // dropDown()
+				work = start;
+				tetrisStep(&work, CMD_DROP, 0);
+				break;
+			case 5: // tetrisMergeData()
+				work = landed;
+				tetrisMergeData(&work);
+				break;
+			case 6: // tetrisClearRow(), it only counts the full rows
+				tetrisClearRow(&work);
+				break;
+			case 7: // tetrisMergeDown()
+				work = merged;
+				tetrisMergeDown(&work, mergedRows);
+				break;
+			case 8: // composeFrame() in rev3
+				frameCompose(&work, 1, dispBuffer);
+				break;
+			case 9: // buildScanFrame() in rev3
+				frameBuild(dispBuffer, scanFrame);
+				break;
+		}
+	}
+	end = benchNow();
+	return(benchPerCall(begin, end));
+}
+
+int main(void){
+	static char *opName[BENCH_OPS] = {"", "tick", "left+right", "rotate", "drop", "merge",
+		"clear row", "merge down", "compose", "scan frame"};
+	int f, op;
+	unsigned long restore, result;
+
+	benchStart("Tetris benchmark");
+	#ifndef HAL_HOST
+	uart0_puts("Column period: ");
+	uart0_print_int(SCAN_PERIOD * CCLK_PER_PCLK);
+	uart0_puts(BENCH_UNIT "\n");
+	#endif
+	for(f = 0; f < BENCH_FIXTURES; f++){
+		loadFixture(&fixture[f]);
+		uart0_puts(fixture[f].name);
+		uart0_puts("\n");
+		restore = runOp(0);
+		for(op = 1; op < BENCH_OPS; op++){
+			if(op == 7 && !mergedRows){
+				continue; // tetrisStep() only calls it for full rows
+			}
+			result = runOp(op);
+			if(op == 1 || op == 4 || op == 5 || op == 7){
+				result = result > restore ? result - restore : 0;
+			}
+			uart0_puts("  ");
+			uart0_puts(opName[op]);
+			uart0_puts(": ");
+			printTenths(result);
+			#ifndef HAL_HOST
+			uart0_puts(" (");
+			printTenths(result * 100 / (SCAN_PERIOD * CCLK_PER_PCLK));
+			uart0_puts("%)");
+			#endif
+			uart0_puts("\n");
+		}
+	}
+	return(benchEnd());
+}
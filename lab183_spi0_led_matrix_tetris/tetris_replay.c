@@ -0,0 +1,156 @@
+/*****************************************************************
+*
+*                          Function tetris_replay.c
+*
+*  plays a replay dump (replay.h) through tetrisStep() on the host
+*  and compares the result with the check of the dump
+*
+*  gcc -O2 -o tetris_replay tetris_replay.c tetris.c
+*  ./tetris_replay [-n repeat] [file]
+*    file    UART capture with a dump, standard input if not given,
+*            text around the dump is skipped
+*    repeat  play the record repeat times and report steps/s
+*
+*  exit code 0 if the game ends in the recorded state
+*
+******************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tetris.h"
+#include "replay.h"
+
+#define LINE_SIZE 256
+
+unsigned char record[REPLAY_SIZE];
+
+// hex value of ch, -1 if it is not a hex digit
+static int hexDigit(int ch){
+	if(ch >= '0' && ch <= '9'){
+		return(ch - '0');
+	}
+	if(ch >= 'a' && ch <= 'f'){
+		return(ch - 'a' + 10);
+	}
+	if(ch >= 'A' && ch <= 'F'){
+		return(ch - 'A' + 10);
+	}
+	return(-1);
+}
+
+/*
+ * play count record bytes from seed
+ * return: steps
+ */
+static unsigned long play(tetrisGame *game, unsigned int seed, int count){
+	unsigned long steps = 0;
+	int index, tick;
+
+	tetrisInit(game, seed);
+	for(index = 0; index < count; index++){
+		if(record[index] & REPLAY_TICK){
+			for(tick = record[index] & REPLAY_TICK_MAX; tick > 0; tick--){
+				tetrisStep(game, CMD_NONE, 1);
+				steps++;
+			}
+		}
+		else{
+			tetrisStep(game, record[index], 0);
+			steps++;
+		}
+	}
+	return(steps);
+}
+
+int main(int argc, char *argv[]){
+	FILE *in = stdin;
+	char line[LINE_SIZE];
+	char *ptr;
+	tetrisGame game;
+	unsigned int seed, check;
+	unsigned long repeat = 1;
+	unsigned long steps = 0;
+	unsigned long index;
+	int count = 0;
+	int size = -1;
+	int hasCheck = 0;
+	int full = 0;
+	int argIndex = 1;
+	int high, low;
+	long number;
+	char *end;
+	clock_t start;
+	double seconds;
+
+	if(argIndex + 1 < argc && strcmp(argv[argIndex], "-n") == 0){
+		number = strtol(argv[argIndex + 1], &end, 0);
+		if(*end != 0 || number < 1){
+			fprintf(stderr, "usage: %s [-n repeat] [file], repeat 1 or more\n", argv[0]);
+			return(2);
+		}
+		repeat = number;
+		argIndex += 2;
+	}
+	if(argIndex < argc){
+		in = fopen(argv[argIndex], "r");
+		if(in == NULL){
+			perror(argv[argIndex]);
+			return(2);
+		}
+	}
+
+	// the last dump in the capture is used
+	while(fgets(line, LINE_SIZE, in)){
+		if(sscanf(line, "Replay: seed 0x%x, %d bytes", &seed, &size) == 2){
+			full = strstr(line, ", full") != NULL;
+			count = 0;
+			hasCheck = 0;
+		}
+		else if(sscanf(line, "Check: 0x%x", &check) == 1 && size >= 0){
+			hasCheck = 1;
+		}
+		else if(size >= 0 && !hasCheck){
+			for(ptr = line; (high = hexDigit(ptr[0])) >= 0 && (low = hexDigit(ptr[1])) >= 0; ptr += 2){
+				if(count < REPLAY_SIZE){
+					record[count++] = (high << 4) | low;
+				}
+			}
+		}
+	}
+	if(in != stdin){
+		fclose(in);
+	}
+	if(size < 0 || !hasCheck){
+		printf("no replay dump found\n");
+		return(2);
+	}
+	if(count != size){
+		printf("dump has %d bytes, header says %d\n", count, size);
+		return(2);
+	}
+
+	start = clock();
+	for(index = 0; index < repeat; index++){
+		steps += play(&game, seed, count);
+	}
+	seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	printf("Seed: 0x%08x, %d bytes, %lu steps\n", seed, count, steps / repeat);
+	printf("Lines: %d, level: %d, %s\n", game.lineErase, game.currentLevel,
+		game.endGameFlag ? "game over" : "playing");
+	if(repeat > 1 && seconds > 0){
+		printf("Time: %.3f s, %.0f steps/s\n", seconds, steps / seconds);
+	}
+	if(full){
+		printf("Check: record was full, not compared\n");
+		return(0);
+	}
+	if(tetrisHash(&game) != check){
+		printf("Check: 0x%08x, recorded 0x%08x, differs\n", tetrisHash(&game), check);
+		return(1);
+	}
+	printf("Check: 0x%08x, same\n", check);
+	return(0);
+}
@@ -0,0 +1,256 @@
+/*****************************************************************
+*
+*                          Function tetris_sim.c
+*
+*  headless game simulator for the host, no timers and no display
+*  plays games through tetrisStep() as fast as the host can and
+*  reports the steps per second
+*
+*  gcc -O2 -o tetris_sim tetris_sim.c tetris.c
+*  ./tetris_sim [-c] [-g] [games] [seed]
+*    -c     check the board and block invariants after every step
+*    -g     greedy player that clears lines, default random input
+*    games  number of games, default 10000
+*    seed   seed of the first game, default 1, game n uses seed + n
+*
+******************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tetris.h"
+
+#define SIM_GAMES 10000
+#define SIM_TICK_LIMIT 100000 // gravity ticks per game
+#define SIM_INPUT_MAX 3       // commands per gravity tick
+#define SIM_PLAN_MAX 16       // commands of a greedy placement
+
+// greedy placement weights, holes and height cost, lines pay
+#define WEIGHT_LINES 76
+#define WEIGHT_HEIGHT 51
+#define WEIGHT_HOLES 36
+#define WEIGHT_BUMPS 18
+
+/*
+ * the invariants the display and the game rely on
+ * return: NULL if they hold, otherwise what failed
+ */
+static const char *checkGame(tetrisGame *game){
+	unsigned int cols[MAX_COL];
+	int index, row, top;
+
+	// bgImage is the column view of boardRow
+	memset(cols, 0, sizeof(cols));
+	for(row = 0; row < MAX_ROW; row++){
+		if(game->boardRow[row] == DATA_MASK){
+			return("full row left on the board");
+		}
+		for(index = 0; index < MAX_COL; index++){
+			if(game->boardRow[row] & (1 << index)){
+				cols[index] |= 1u << row;
+			}
+		}
+	}
+	for(index = 0; index < MAX_COL; index++){
+		if(cols[index] != game->bgImage[index]){
+			return("bgImage differs from boardRow");
+		}
+		for(row = 0; row < MAX_ROW && !(cols[index] & (1u << row)); row++);
+		if(game->skyline[index] != row){
+			return("skyline differs from bgImage");
+		}
+	}
+	if(!game->showBlock || game->newShapeFlag){
+		return(NULL);
+	}
+	// the falling block is inside the board and off the background
+	top = game->currentRow - BASE_ROW;
+	memset(cols, 0, sizeof(cols));
+	for(index = 0; index < BLOCK_SIZE; index++){
+		if(game->blockRow[index] == 0){
+			continue;
+		}
+		if(top + index < 0 || top + index >= MAX_ROW){
+			return("block outside the board");
+		}
+		// a new block may land on the stack, the next tick ends the game
+		if((game->boardRow[top + index] & game->blockRow[index]) && game->currentRow != BASE_ROW){
+			return("block overlaps the background");
+		}
+		for(row = 0; row < MAX_COL; row++){
+			if(game->blockRow[index] & (1 << row)){
+				cols[row] |= 1u << (top + index);
+			}
+		}
+	}
+	for(index = 0; index < MAX_COL; index++){
+		if(cols[index] != game->myBlock[index]){
+			return("myBlock differs from blockRow");
+		}
+	}
+	return(NULL);
+}
+
+// score of the board after a placement, higher is better
+static int scoreBoard(tetrisGame *game, int lines){
+	int index, height;
+	int last = 0;
+	int score = lines * WEIGHT_LINES;
+	unsigned int col;
+
+	for(index = 0; index < MAX_COL; index++){
+		height = MAX_ROW - game->skyline[index];
+		score -= height * WEIGHT_HEIGHT;
+		// empty cells under the top of the column
+		for(col = ~game->bgImage[index] >> game->skyline[index]; col; col &= col - 1){
+			if(game->skyline[index] < MAX_ROW){
+				score -= WEIGHT_HOLES;
+			}
+		}
+		if(index > 0){
+			score -= (height > last ? height - last : last - height) * WEIGHT_BUMPS;
+		}
+		last = height;
+	}
+	return(score);
+}
+
+/*
+ * try every rotation and column of the new block on a copy of the
+ * game and write the commands of the best placement into plan
+ * return: number of commands
+ */
+static int planGreedy(tetrisGame *game, char *plan){
+	tetrisGame trial;
+	int rotate, shift, index, score;
+	int bestScore = 0;
+	int bestRotate = -1;
+	int bestShift = 0;
+	int count = 0;
+	char move;
+
+	for(rotate = 0; rotate < BLOCK_VAR; rotate++){
+		for(shift = -MAX_COL/2; shift <= MAX_COL/2; shift++){
+			trial = *game;
+			move = shift < 0 ? CMD_LEFT : CMD_RIGHT;
+			for(index = 0; index < rotate; index++){
+				tetrisStep(&trial, CMD_ROTATE_CW, 0);
+			}
+			for(index = 0; index < abs(shift); index++){
+				if(!(tetrisStep(&trial, move, 0) & EVENT_MOVED)){
+					break;
+				}
+			}
+			if(index < abs(shift)){
+				continue; // against the wall, same as a shorter shift
+			}
+			tetrisStep(&trial, CMD_DROP, 0);
+			tetrisStep(&trial, CMD_NONE, 1);
+			score = scoreBoard(&trial, trial.lineErase - game->lineErase);
+			if(trial.endGameFlag){
+				score -= MAX_ROW * MAX_COL * WEIGHT_HEIGHT;
+			}
+			if(bestRotate < 0 || score > bestScore){
+				bestScore = score;
+				bestRotate = rotate;
+				bestShift = shift;
+			}
+		}
+	}
+	for(index = 0; index < bestRotate; index++){
+		plan[count++] = CMD_ROTATE_CW;
+	}
+	for(index = 0; index < abs(bestShift); index++){
+		plan[count++] = bestShift < 0 ? CMD_LEFT : CMD_RIGHT;
+	}
+	plan[count++] = CMD_DROP;
+	return(count);
+}
+
+int main(int argc, char *argv[]){
+	tetrisGame game;
+	unsigned int inputState;
+	unsigned long games = SIM_GAMES;
+	unsigned int seed = 1;
+	unsigned long steps = 0;
+	unsigned long pieces = 0;
+	unsigned long lines = 0;
+	unsigned long gameIndex, tick;
+	char plan[SIM_PLAN_MAX];
+	int check = 0;
+	int greedy = 0;
+	int argIndex = 1;
+	int count, events, index;
+	const char *error;
+	clock_t start;
+	double seconds;
+
+	for(; argIndex < argc && argv[argIndex][0] == '-'; argIndex++){
+		if(strcmp(argv[argIndex], "-c") == 0){
+			check = 1;
+		}
+		else if(strcmp(argv[argIndex], "-g") == 0){
+			greedy = 1;
+		}
+		else{
+			printf("usage: %s [-c] [-g] [games] [seed]\n", argv[0]);
+			return(1);
+		}
+	}
+	if(argIndex < argc){
+		games = strtoul(argv[argIndex++], NULL, 0);
+	}
+	if(argIndex < argc){
+		seed = (unsigned int) strtoul(argv[argIndex++], NULL, 0);
+	}
+
+	start = clock();
+	for(gameIndex = 0; gameIndex < games; gameIndex++){
+		tetrisInit(&game, seed + gameIndex);
+		events = 0;
+		inputState = ~(seed + gameIndex); // player, apart from the pieces
+		if(inputState == 0){
+			inputState = 1;
+		}
+		for(tick = 0; tick < SIM_TICK_LIMIT && !game.endGameFlag; tick++){
+			count = 0;
+			if(!greedy){
+				count = randomRange(&inputState, SIM_INPUT_MAX + 1);
+				for(index = 0; index < count; index++){
+					plan[index] = 1 + randomRange(&inputState, CMD_ROTATE_180);
+				}
+			}
+			else if(events & EVENT_NEW_BLOCK){
+				count = planGreedy(&game, plan);
+			}
+			for(index = 0; index < count; index++){
+				tetrisStep(&game, plan[index], 0);
+				steps++;
+				if(check && (error = checkGame(&game)) != NULL){
+					printf("game %lu seed 0x%08x tick %lu: %s\n", gameIndex, game.seed, tick, error);
+					return(1);
+				}
+			}
+			events = tetrisStep(&game, CMD_NONE, 1);
+			steps++;
+			if(events & EVENT_NEW_BLOCK){
+				pieces++;
+			}
+			if(check && (error = checkGame(&game)) != NULL){
+				printf("game %lu seed 0x%08x tick %lu: %s\n", gameIndex, game.seed, tick, error);
+				return(1);
+			}
+		}
+		lines += game.lineErase;
+	}
+	seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	printf("Games: %lu, steps: %lu, pieces: %lu, lines: %lu\n", games, steps, pieces, lines);
+	printf("Time: %.3f s", seconds);
+	if(seconds > 0){
+		printf(", %.0f steps/s", steps / seconds);
+	}
+	printf("\n");
+	return(0);
+}
@@ -1,14 +1,8 @@
 #include <string.h>
-#include <LPC213X.h>
+#include "hal.h"
+#include "lpc213x_vic.h"
 #include "uart0.h"
-
-
-// Fosc = 19.6608 Mhz 
-// CCLK = Fosc*3
-// PCLK = CCLK/2
-#define PCLK 29491200
-#define MAX_DIGIT 10
-#define MAX_DECIMAL 6
+#include "format.h"
 
 
 #define CNTLQ      0x11
@@ -18,44 +12,204 @@
 #define CR         0x0D
 #define LF         0x0A
 
+#define RX_MASK (UART0_RX_SIZE - 1)
+#define TX_MASK (UART0_TX_SIZE - 1)
+
+// receive ring, rxHead is only written by uart0IRQ(), rxTail only by
+// the reader, the indices run free and are masked on access
+static volatile unsigned char rxBuffer[UART0_RX_SIZE];
+static volatile unsigned int rxHead;
+static volatile unsigned int rxTail;
+static char intOn; // uart0_init_int() has been called
+unsigned int uart0RxDropped; // characters lost to a full ring
+
+// transmit ring, txHead is only written by the writer, txTail only
+// by uart0IRQ() or with VIC_UART0 masked, txBusy while the
+// transmitter has characters from the ring
+static volatile unsigned char txBuffer[UART0_TX_SIZE];
+static volatile unsigned int txHead;
+static volatile unsigned int txTail;
+static volatile char txBusy;
+static char txPolicy = UART0_TX_POLICY;
+unsigned int uart0TxDropped; // characters lost to a full ring
+
+/*
+ * the transmitter is empty, give it up to a FIFO of the ring
+ * call from uart0IRQ() or with VIC_UART0 masked
+ */
+static void txFill(void)
+{
+  int count;
+
+  for(count = 0; count < HAL_UART_FIFO && txTail != txHead; count++){
+    hal_uart_write(txBuffer[txTail & TX_MASK]);
+    txTail++;
+  }
+  txBusy = (count != 0);
+}
+
+// put ch into the transmit ring, a full ring is handled by txPolicy
+static void txPut(int ch)
+{
+  if(txHead - txTail >= UART0_TX_SIZE){
+    if(txPolicy == UART0_TX_BLOCK){
+      while(txHead - txTail >= UART0_TX_SIZE){
+        hal_idle();
+      }
+    }
+    else if(txPolicy == UART0_TX_OVERWRITE){
+      hal_irq_disable(VIC_UART0); // the tail belongs to uart0IRQ()
+      if(txHead - txTail >= UART0_TX_SIZE){
+        txTail++; // drop the oldest
+        uart0TxDropped++;
+      }
+      hal_irq_enable(VIC_UART0);
+    }
+    else{
+      uart0TxDropped++;
+      return;
+    }
+  }
+  txBuffer[txHead & TX_MASK] = ch;
+  txHead++; // publish after the data
+  // an idle transmitter gives no interrupt, start it here
+  if(!txBusy){
+    hal_irq_disable(VIC_UART0);
+    if(!txBusy && hal_uart_tx_ready()){
+      txFill();
+    }
+    hal_irq_enable(VIC_UART0);
+  }
+}
+
 void uart0_init(unsigned int baudrate)
 {
-  unsigned short u0dl;
-  PINSEL0 &= 0xFFFFFFF0; // Reset P0.0,P0.1 Pin Config
-  PINSEL0 |= 0x00000001; // P0.0 = TxD0
-  PINSEL0 |= 0x00000004; // P0.1 = RxD0
-  
-  U0LCR &= 0xFC; // Reset Word Select
-  U0LCR |= 0x03; // World Lenght = 8 bit
-  U0LCR &= 0xFB; // Stop Bit = 1 bit
-  U0LCR &= 0xF7; // Disable Parity
-  U0LCR &= 0xBF; // Disable Break Control
-  U0LCR |= 0x80; // Enable Divisor Latch Access Bit
-  
-  u0dl = PCLK / (baudrate << 4);// u0dl = PCLK/(16 x Buad)
-  U0DLL = u0dl & 0xFF;
-  U0DLM = (u0dl >> 8);
-  
-  U0LCR &= 0x7F; // Disable Divisor Latch Access Bit
-}
-
-// Write character to Serial Port
+  hal_uart_init(baudrate); // 8 bit, 1 stop bit, no parity
+}
+
+// Write character to Serial Port, through the ring after uart0_init_int()
 int uart0_putchar(int ch)
 {
+  if(intOn){
+    if(ch == '\n'){
+      txPut(0x0D);
+    }
+    txPut(ch);
+    return(ch);
+  }
   if(ch == '\n')
   {
-    while(!(U0LSR & 0x20));
-    U0THR = 0x0D;
+    while(!hal_uart_tx_ready());
+    hal_uart_write(0x0D);
+  }
+  while(!hal_uart_tx_ready());
+  hal_uart_write(ch);
+  return(ch);
+}
+
+// write count bytes as they are, no CR is added
+void uart0_write(const unsigned char *data, int count)
+{
+  int index;
+
+  for(index = 0; index < count; index++){
+    if(intOn){
+      txPut(data[index]);
+    }
+    else{
+      while(!hal_uart_tx_ready());
+      hal_uart_write(data[index]);
+    }
+  }
+}
+
+// what uart0_putchar() does with a full ring, return: the old policy
+int uart0_set_tx_policy(int policy)
+{
+  int old = txPolicy;
+
+  txPolicy = policy;
+  return(old);
+}
+
+// room for a write that must not be dropped or wait
+int uart0_tx_free(void)
+{
+  if(!intOn){
+    return(UART0_TX_SIZE);
+  }
+  return(UART0_TX_SIZE - (txHead - txTail));
+}
+
+/*
+ * move the received characters into the ring, the FIFO is emptied
+ * even if the ring is full so the interrupt goes away
+ * refill the transmitter from its ring when it is empty
+ */
+__irq void uart0IRQ(void)
+{
+  unsigned int head;
+  unsigned char ch;
+
+  while(!(hal_uart_int_id() & HAL_IIR_NONE)){
+    head = rxHead;
+    while(hal_uart_rx_ready()){
+      ch = hal_uart_read();
+      if(head - rxTail < UART0_RX_SIZE){
+        rxBuffer[head & RX_MASK] = ch;
+        head++;
+      }
+      else{
+        uart0RxDropped++;
+      }
+    }
+    rxHead = head; // publish after the data
+    if(hal_uart_tx_ready()){
+      txFill();
+    }
   }
-  while(!(U0LSR & 0x20));
-  return(U0THR = ch);
+  hal_irq_end(); // return interrupt
+}
+
+// receive and transmit through uart0IRQ() from now on
+void uart0_init_int(void)
+{
+  rxHead = 0;
+  rxTail = 0;
+  txHead = 0;
+  txTail = 0;
+  txBusy = 0;
+  intOn = 1;
+  hal_irq_install(UART0_VIC_SLOT, VIC_UART0, uart0IRQ);
+  hal_uart_rx_int_enable();
+  hal_uart_tx_int_enable();
+}
+
+// Read character from Serial Port, -1 if none has been received
+int uart0_try_getchar(void)
+{
+  int ch;
+
+  if(!intOn){
+    return (hal_uart_rx_ready() ? hal_uart_read() : -1);
+  }
+  if(rxHead == rxTail){
+    return (-1);
+  }
+  ch = rxBuffer[rxTail & RX_MASK];
+  rxTail++; // free the slot after the data is read
+  return (ch);
 }
 
 // Read character from Serial Port
 int uart0_getchar(void)
 {
-  while(!(U0LSR & 0x01));
-  return (U0RBR);
+  int ch;
+
+  while((ch = uart0_try_getchar()) < 0){
+    hal_idle();
+  }
+  return (ch);
 }
 
 // write string to UART0
@@ -71,103 +225,62 @@ int uart0_puts(char *str_in)
 		return str_in_len;
 }
 
-void uart0_print_int(int num)
+// send count characters of a fmt_ buffer
+static void putBuffer(const char *buf, int count)
 {
-	int num_temp = num;
 	int index;
-	int digit_count = 0;
-	int digit[MAX_DIGIT];
 
-	if(num_temp == 0){
-		uart0_putchar('0');
-		return;
+	for(index = 0; index < count; index++){
+		uart0_putchar(buf[index]);
 	}
+}
 
-	if(num < 0){
-		uart0_putchar('-');
-		num_temp = -num;
-	}
-	
-	while(num_temp > 0){
-		digit[digit_count] = num_temp%10;
-		num_temp = num_temp/10;
-		digit_count++;
-		if(digit_count >= MAX_DIGIT)
-			break;
-	}
-	
-	for(index = digit_count-1; index >= 0; index--){
-		uart0_putchar(digit[index]+'0');
-	}
-	
+void uart0_print_int(int num)
+{
+	char buf[FMT_SIZE];
+
+	putBuffer(buf, fmt_int(buf, num));
 }
 
-void uart0_print_double(double num, int precision)
+void uart0_print_hex(unsigned int num, int digits)
 {
-	double decimal_temp = num - (int) num;
-	int num_temp;
-	int index;
-	int max_precision;
-	int digit[MAX_DECIMAL];
-	int carry_over;
-	
-	if(precision > MAX_DECIMAL){
-		max_precision = MAX_DECIMAL;
-	}
-	else{
-		max_precision = precision;
-	}
-	
-	for(index = 0; index <= max_precision; index++){
-		
-		decimal_temp = decimal_temp*10;
-		digit[index] = (int) (decimal_temp);
-		decimal_temp = decimal_temp - digit[index];
-	}
-	
-	num_temp = (int) decimal_temp; // get all decimal point to be print + 1
-	
-	if(digit[max_precision] >= 5)
-		carry_over = 1;
-	else
-		carry_over = 0; // inialize carry over
-	
-	// perform the rounding
-	for(index = max_precision - 1; index >= 0; index--){
-	  digit[index] += carry_over; // add carry over
-		if(digit[index] == 10){
-			carry_over = 1;
-			digit[index] = 0; // reset index
-		}
-		else{
-			carry_over = 0;
-			break;
-		}
-	}
+	char buf[FMT_SIZE];
 
-	num_temp += (int) num + carry_over; // add carry over if any
-	
-	uart0_print_int(num_temp); // print part integer first
+	putBuffer(buf, fmt_hex(buf, num, digits));
+}
 
-	if(precision == 0){
-		return;
-	}
-	else{
-		uart0_putchar('.');
-	}
-	
-	for(index = 0; index < max_precision ; index++){
-		uart0_putchar(digit[index]+'0');
-	}
-	
+void uart0_print_bin(unsigned int num, int digits)
+{
+	char buf[FMT_SIZE];
+
+	putBuffer(buf, fmt_bin(buf, num, digits));
+}
+
+void uart0_print_fixed(int num, int frac_bits, int precision)
+{
+	char buf[FMT_SIZE];
+
+	putBuffer(buf, fmt_fixed(buf, num, frac_bits, precision));
+}
+
+int uart0_printf(const char *format, ...)
+{
+	va_list args;
+	int count;
+
+	va_start(args, format);
+	count = fmt_vprint(uart0_putchar, format, args);
+	va_end(args);
+	return(count);
 }
 
 
+#ifndef HAL_HOST // the host C library has its own
 int getchar(void)
 {
-  while(!(U0LSR & 0x01));
-  return (U0RBR);
+  return (uart0_getchar());
 }
+#endif
 
 void uart0_getline (char *line, int n)  {
   int  cnt = 0;
@@ -1,34 +1,143 @@
+/*****************************************************************
+*
+*                          Function delay.c
+*
+*  delays counted on DELAY_TIMER running free at PCLK instead of
+*  instruction loops, right for any PLL, MAM or compiler setting
+*  and not stretched by the interrupts that come in meanwhile
+*
+*  a deadline is a TC value, compared as (int) (TC - deadline) so
+*  the wrap every 2^32 ticks does not matter, deadlines and counts
+*  are unsigned int because the host unsigned long has 64 bits and
+*  would not wrap with TC, long delays are taken a second at a time
+*  delays are rounded up to whole ticks and get one more for the
+*  part of the tick the start was read in, they are never short
+*
+*  MR1 is armed at the deadline, delay_sleep_until() idles the core
+*  between interrupts and MR1 wakes it, the MR0 wrap leaves MR1
+*  armed while the deadline is ahead, the handler arms MR1 again
+*  DELAY_REARM ticks later while a sleep is on, so an alarm that
+*  fires between the check and the sleep costs that much and not a
+*  hang, the host clock stops at the deadline of a busy wait too
+*
+******************************************************************/
 
 #include "delay.h"
 
-#define MYDELAY_COUNT 96
+#define DELAY_CHUNK_US 1000000
+#define DELAY_REARM delay_ticks(10)
+#define delay_count() ((unsigned int) hal_timer_count(DELAY_TIMER))
 
+HAL_TIMER_OWNER(DELAY_CHANNEL);
 
-void delay_10us(long mydelay)
+static char delayOn;
+static volatile char delayWaiting; // a delay has MR1 at delayDeadline
+static volatile char delaySleeping;
+static volatile unsigned int delayDeadline;
+
+__irq void delayIRQ(void);
+
+/* Start DELAY_TIMER, the delays call it the first time */
+void delay_init(void)
 {
-	int index1;
-	long	index2;
-	for(index2 = 0; index2 < mydelay; index2++){
-		for(index1 = 0; index1 < MYDELAY_COUNT; index1++){
-		// empty for loop
-		}
+	hal_timer_start(DELAY_TIMER, 0, 0xFFFFFFFF);	// count PCLK, never reset
+	hal_irq_install(DELAY_SLOT, DELAY_CHANNEL, delayIRQ);
+	delayOn = 1;
+}
+
+unsigned int delay_now(void)
+{
+	if(!delayOn){
+		delay_init();
 	}
+	return(delay_count());
 }
 
-void delay_ms(int mydelay)
+/* Busy wait, interrupts keep running */
+void delay_until(unsigned int deadline)
 {
-	int index1;
-	for(index1 = 0; index1 < mydelay; index1++){
-		delay_10us(100);
+	delayDeadline = deadline;
+	delayWaiting = 1;
+	hal_timer_set_alarm(DELAY_TIMER, deadline);
+	while((int) (delay_count() - deadline) < 0){
+		hal_idle();
+	}
+	delayWaiting = 0;
+	hal_timer_alarm_off(DELAY_TIMER);
+}
+
+/* Sleep in PCON idle mode, any interrupt wakes the core for a check */
+void delay_sleep_until(unsigned int deadline)
+{
+	delayDeadline = deadline;
+	delayWaiting = 1;
+	delaySleeping = 1;
+	hal_timer_set_alarm(DELAY_TIMER, deadline);
+	while((int) (delay_count() - deadline) < 0){
+		hal_sleep();
+	}
+	delaySleeping = 0;
+	delayWaiting = 0;
+	hal_timer_alarm_off(DELAY_TIMER);
+}
+
+void delay_us(unsigned long us)
+{
+	unsigned int start = delay_now();
+
+	for(; us > DELAY_CHUNK_US; us -= DELAY_CHUNK_US){
+		start += delay_ticks(DELAY_CHUNK_US);
+		delay_until(start);
 	}
+	delay_until(start + delay_ticks(us) + 1);
 }
 
+void delay_sleep_us(unsigned long us)
+{
+	unsigned int start = delay_now();
+
+	for(; us > DELAY_CHUNK_US; us -= DELAY_CHUNK_US){
+		start += delay_ticks(DELAY_CHUNK_US);
+		delay_sleep_until(start);
+	}
+	delay_sleep_until(start + delay_ticks(us) + 1);
+}
+
+/* MR1 reached, or the MR0 wrap */
+__irq void delayIRQ(void)
+{
+	hal_timer_alarm_off(DELAY_TIMER);
+	hal_timer_clear_int(DELAY_TIMER);
+	if(delayWaiting && (int) (delay_count() - delayDeadline) < 0){
+		hal_timer_set_alarm(DELAY_TIMER, delayDeadline); // the wrap
+	}
+	else if(delaySleeping){
+		hal_timer_set_alarm(DELAY_TIMER, delay_count() + DELAY_REARM);
+	}
+	hal_irq_end();
+}
 
+void delay_10us(long mydelay)
+{
+	for(; mydelay > DELAY_CHUNK_US / 10; mydelay -= DELAY_CHUNK_US / 10){
+		delay_us(DELAY_CHUNK_US);
+	}
+	if(mydelay > 0){
+		delay_us(mydelay * 10);
+	}
+}
+
+void delay_ms(int mydelay)
+{
+	if(mydelay > 0){
+		delay_10us(mydelay * 100L);
+	}
+}
 
 void delay_sec(int mydelay)
 {
 	int index1;
 	for(index1 = 0; index1 < mydelay; index1++){
-		delay_10us(99999);
+		delay_us(DELAY_CHUNK_US);
 	}
 }
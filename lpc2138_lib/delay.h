@@ -1,6 +1,50 @@
+/*****************************************************************
+*
+*                          Function delay.h
+*
+*  delays counted on a free-running timer, see delay.c
+*
+*  DELAY_TIMER belongs to this module once a delay has run, the
+*  program must not start, stop or install a handler on it, and
+*  lcd_init() borrows LCD_TIMER to time its own loop, so call it
+*  before the first delay when both are Timer1
+*  the timer wheel (wheel.h) takes the PWM block, a build that puts
+*  both on one timer stops with an error, at compile time if a file
+*  includes both headers, at link time otherwise (HAL_TIMER_OWNER)
+*
+******************************************************************/
+
 #ifndef __DELAY_H
 #define __DELAY_H
 
+#include "hal.h"
+#include "lpc213x_vic.h"
+
+// the timer, its VIC channel and the vector slot of the wake up
+#ifndef DELAY_TIMER
+#define DELAY_TIMER HAL_TIMER1
+#define DELAY_CHANNEL VIC_TIMER1
+#endif
+#ifndef DELAY_SLOT
+#define DELAY_SLOT 15
+#endif
+#if defined(WHEEL_CHANNEL) && WHEEL_CHANNEL == DELAY_CHANNEL
+#error "delay.h and wheel.h on the same timer"
+#endif
+
+// PCLK ticks in us microseconds, rounded up, us < 145 seconds
+#define DELAY_TICKS_US_FRAC ((((unsigned long long) (HAL_PCLK % 1000000) << 32) + 999999) / 1000000)
+#define delay_ticks(us) ((unsigned int) ((us) * (HAL_PCLK / 1000000) + \
+	(((unsigned long long) (us) * DELAY_TICKS_US_FRAC + 0xFFFFFFFFULL) >> 32)))
+
+extern void delay_init(void);
+extern unsigned int delay_now(void);		// PCLK ticks, wraps every 145 s
+extern void delay_until(unsigned int);		// deadline, delay_now() + 72 s at most
+extern void delay_sleep_until(unsigned int);
+extern void delay_us(unsigned long);
+extern void delay_sleep_us(unsigned long);
+
+// the old loop delays, now on the timer
 extern void delay_10us(long);
 extern void delay_ms(int);
 extern void delay_sec(int);
@@ -0,0 +1,274 @@
+#include "format.h"
+
+/* x/100 as a multiply by 2^37/100, exact for every 32 bit x,
+ * UMULL takes a few cycles where a division is a library call of
+ * about 100
+ */
+#define DIV100(x) ((unsigned int) (((unsigned long long) (x) * 0x51EB851FUL) >> 37))
+
+// two digits per table entry, one multiply per pair
+static const char digitPair[200] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static const char hexDigit[16] = "0123456789abcdef";
+
+static const unsigned int power10[FMT_PRECISION_MAX + 1] = {
+	1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+int fmt_uint(char *buf, unsigned int value)
+{
+	char temp[10];
+	char *ptr = temp + sizeof(temp); // filled from the end
+	unsigned int quot, pair;
+	int count, index;
+
+	while(value >= 100){
+		quot = DIV100(value);
+		pair = (value - quot*100) * 2;
+		*--ptr = digitPair[pair + 1];
+		*--ptr = digitPair[pair];
+		value = quot;
+	}
+	if(value >= 10){
+		*--ptr = digitPair[value*2 + 1];
+		*--ptr = digitPair[value*2];
+	}
+	else{
+		*--ptr = value + '0';
+	}
+	count = temp + sizeof(temp) - ptr;
+	for(index = 0; index < count; index++){
+		buf[index] = ptr[index];
+	}
+	buf[count] = 0;
+	return(count);
+}
+
+int fmt_int(char *buf, int value)
+{
+	if(value < 0){
+		buf[0] = '-';
+		return(fmt_uint(buf + 1, 0U - (unsigned int) value) + 1); // INT_MIN too
+	}
+	return(fmt_uint(buf, value));
+}
+
+int fmt_hex(char *buf, unsigned int value, int digits)
+{
+	int count = 1;
+	int index;
+
+	while(count < 8 && (value >> (4*count)) != 0){
+		count++;
+	}
+	if(digits > count){
+		count = digits > 8 ? 8 : digits;
+	}
+	for(index = count - 1; index >= 0; index--){
+		buf[index] = hexDigit[value & 0xF];
+		value >>= 4;
+	}
+	buf[count] = 0;
+	return(count);
+}
+
+int fmt_bin(char *buf, unsigned int value, int digits)
+{
+	int count = 1;
+	int index;
+
+	while(count < 32 && (value >> count) != 0){
+		count++;
+	}
+	if(digits > count){
+		count = digits > 32 ? 32 : digits;
+	}
+	for(index = count - 1; index >= 0; index--){
+		buf[index] = '0' + (value & 1);
+		value >>= 1;
+	}
+	buf[count] = 0;
+	return(count);
+}
+
+/*
+ * frac * 10^precision in 64 bits is the decimals in the top word and
+ * the rest in the bottom one, rounding is exact, a tie goes up
+ */
+int fmt_fraction(char *buf, int negative, unsigned int whole,
+	unsigned int frac, int precision)
+{
+	unsigned long long temp;
+	unsigned int decimals;
+	char digits[FMT_SIZE];
+	int count, index, size;
+
+	if(precision < 0){
+		precision = 0;
+	}
+	if(precision > FMT_PRECISION_MAX){
+		precision = FMT_PRECISION_MAX;
+	}
+	temp = (unsigned long long) frac * power10[precision];
+	decimals = (unsigned int) (temp >> 32);
+	if((unsigned int) temp >= 0x80000000){
+		decimals++;
+		if(decimals == power10[precision]){ // carry into the whole part
+			decimals = 0;
+			whole++;
+		}
+	}
+	count = 0;
+	if(negative && (whole != 0 || decimals != 0)){
+		buf[count++] = '-'; // no -0.00
+	}
+	count += fmt_uint(buf + count, whole);
+	if(precision == 0){
+		return(count);
+	}
+	buf[count++] = '.';
+	size = fmt_uint(digits, decimals);
+	for(index = size; index < precision; index++){
+		buf[count++] = '0';
+	}
+	for(index = 0; index <= size; index++){
+		buf[count + index] = digits[index];
+	}
+	return(count + size);
+}
+
+int fmt_fixed(char *buf, int value, int frac_bits, int precision)
+{
+	unsigned int mag = value < 0 ? 0U - (unsigned int) value : (unsigned int) value;
+
+	if(frac_bits <= 0){
+		return(fmt_fraction(buf, value < 0, mag, 0, precision));
+	}
+	// a shift by 32 or more is undefined in C, all of mag is fraction
+	if(frac_bits >= 64){
+		return(fmt_fraction(buf, value < 0, 0, 0, precision));
+	}
+	if(frac_bits >= 32){
+		return(fmt_fraction(buf, value < 0, 0, mag >> (frac_bits - 32), precision));
+	}
+	return(fmt_fraction(buf, value < 0, mag >> frac_bits,
+		mag << (32 - frac_bits), precision));
+}
+
+// width characters of pad around count of text, the sign goes first
+static int putField(int (*put)(int), const char *text, int count,
+	int width, char pad, int left)
+{
+	int index = 0;
+	int total = count > width ? count : width;
+
+	if(pad == '0' && text[0] == '-'){
+		put('-');
+		index = 1;
+	}
+	if(!left){
+		for(; width > count; width--){
+			put(pad);
+		}
+	}
+	for(; index < count; index++){
+		put(text[index]);
+	}
+	for(; width > count; width--){
+		put(' ');
+	}
+	return(total);
+}
+
+int fmt_vprint(int (*put)(int), const char *format, va_list args)
+{
+	char buf[FMT_SIZE];
+	const char *text;
+	unsigned int value;
+	int total = 0;
+	int count, index, width, left, isLong;
+	char pad;
+
+	for(; *format; format++){
+		if(*format != '%'){
+			put(*format);
+			total++;
+			continue;
+		}
+		format++;
+		left = 0;
+		pad = ' ';
+		for(;; format++){
+			if(*format == '-'){
+				left = 1;
+			}
+			else if(*format == '0'){
+				pad = '0';
+			}
+			else{
+				break;
+			}
+		}
+		if(left){
+			pad = ' '; // - wins over 0
+		}
+		width = 0;
+		while(*format >= '0' && *format <= '9'){
+			width = width*10 + *format++ - '0';
+		}
+		isLong = *format == 'l';
+		if(isLong){
+			format++;
+		}
+		if(*format == 0){
+			break;
+		}
+		text = buf;
+		switch(*format){
+			case 'd':
+			case 'i':
+				count = fmt_int(buf, isLong ? (int) va_arg(args, long) : va_arg(args, int));
+				break;
+			case 'u':
+			case 'x':
+			case 'X':
+				value = isLong ? (unsigned int) va_arg(args, unsigned long) : va_arg(args, unsigned int);
+				if(*format == 'u'){
+					count = fmt_uint(buf, value);
+					break;
+				}
+				count = fmt_hex(buf, value, 0);
+				for(index = 0; *format == 'X' && index < count; index++){
+					if(buf[index] >= 'a'){
+						buf[index] -= 'a' - 'A';
+					}
+				}
+				break;
+			case 'c':
+				buf[0] = va_arg(args, int);
+				count = 1;
+				break;
+			case 's':
+				text = va_arg(args, const char *);
+				for(count = 0; text[count]; count++);
+				pad = ' ';
+				break;
+			default: // %% and anything unknown
+				buf[0] = *format;
+				count = 1;
+				break;
+		}
+		total += putField(put, text, count, width, pad, left);
+	}
+	return(total);
+}
@@ -0,0 +1,41 @@
+#ifndef __FORMAT_H
+#define __FORMAT_H
+
+#include <stdarg.h>
+
+/* number to text without division or floating point, for a core
+ * with neither (ARM7TDMI)
+ * the fmt_ functions write into buf, add a 0 and return the length,
+ * buf needs FMT_SIZE characters
+ */
+#define FMT_SIZE 34          // 32 binary digits
+#define FMT_PRECISION_MAX 9  // decimals of a 32 bit fraction
+
+/* decimal */
+extern int fmt_uint(char *buf, unsigned int value);
+extern int fmt_int(char *buf, int value);
+
+/* hex and binary, lowercase, padded with 0 to digits, 0 = no padding */
+extern int fmt_hex(char *buf, unsigned int value, int digits);
+extern int fmt_bin(char *buf, unsigned int value, int digits);
+
+/* signed fixed point with frac_bits fraction bits, 16 for Q16.16,
+ * 24 for Q8.24, 32 for Q0.32, rounded to precision decimals, more
+ * than 32 bits lose the ones below 2^-32
+ */
+extern int fmt_fixed(char *buf, int value, int frac_bits, int precision);
+
+/* whole + frac/2^32, rounded to precision decimals */
+extern int fmt_fraction(char *buf, int negative, unsigned int whole,
+	unsigned int frac, int precision);
+
+/* printf() subset: %d %i %u %x %X %c %s %%, flags - and 0, width,
+ * l is accepted (long is int on the target), no precision and no
+ * floating point
+ * every character goes to put(), there is no static state so it can
+ * run in more than one context at a time
+ * return: characters written
+ */
+extern int fmt_vprint(int (*put)(int), const char *format, va_list args);
+
+#endif // __FORMAT_H
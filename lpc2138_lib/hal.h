@@ -0,0 +1,111 @@
+/*****************************************************************
+*
+*                          Function hal.h
+*
+*  Hardware abstraction layer: GPIO, SPI0, UART0, timers, VIC, RTC
+*  LPC2138 backend: hal_lpc2138.h (register macros) + hal_lpc2138.c
+*  host backend:    hal_host.h + hal_host.c, build with -DHAL_HOST
+*
+*  Keil: add lpc2138_lib to the include path and hal_lpc2138.c
+*  to the project
+*
+******************************************************************/
+
+#ifndef __HAL_H
+#define __HAL_H
+
+// Fosc = 19.6608 Mhz
+// CCLK = Fosc*3
+// PCLK = CCLK/2
+#define HAL_PCLK 29491200
+
+#ifdef HAL_HOST
+#include "hal_host.h"
+#else
+#include "hal_lpc2138.h"
+#endif
+
+/*
+ * both backends provide
+ *
+ * GPIO, port 0 or 1
+ *   hal_gpio_output(port, mask)  pins in mask as GPIO output
+ *   hal_gpio_input(port, mask)   pins in mask as input, after
+ *                                hal_gpio_output()
+ *   hal_gpio_set(port, mask)     drive pins high
+ *   hal_gpio_clr(port, mask)     drive pins low
+ *   hal_gpio_read(port)          pin levels
+ *
+ * SPI0, 16-bit master, CPOL = CPHA = 0, MSB first
+ *   hal_spi_init(divider)        SCK = PCLK/divider
+ *   hal_spi_write(data)          start sending a word
+ *   hal_spi_read()               received word
+ *   hal_spi_done()               nonzero once the word is out (SPIF)
+ *   hal_spi_int_enable()         interrupt on SPIF
+ *   hal_spi_int_disable()
+ *   hal_spi_int_clear()
+ *
+ * UART0, 8N1
+ *   hal_uart_init(baudrate)
+ *   hal_uart_tx_ready()          room for a character
+ *   hal_uart_write(ch)
+ *   hal_uart_rx_ready()          a character has been received
+ *   hal_uart_read()
+ *   hal_uart_rx_int_enable()     interrupt while a character is waiting
+ *   hal_uart_rx_int_disable()
+ *   hal_uart_tx_int_enable()     interrupt when the transmitter is empty
+ *   hal_uart_tx_int_disable()
+ *   hal_uart_int_id()            pending source, HAL_IIR_xxx, reading
+ *                                it clears HAL_IIR_THRE
+ *
+ * timers HAL_TIMER0, HAL_TIMER1, HAL_PWM, interrupt and reset on MR0
+ *   hal_timer_start(timer, prescale, match)  period (prescale+1)*(match+1)
+ *   hal_timer_stop(timer)        reset, hold and clear the interrupt
+ *   hal_timer_set_match(timer, match)
+ *   hal_timer_match(timer)
+ *   hal_timer_count(timer)       TC
+ *   hal_timer_prescale_count(timer)  PC
+ *   hal_timer_clear_int(timer)
+ *   hal_timer_set_alarm(timer, count)  interrupt on MR1 when TC
+ *                                reaches count, no reset
+ *   hal_timer_alarm_off(timer)   no MR1 interrupt, its flag cleared
+ *
+ * VIC, channels from lpc213x_vic.h
+ *   hal_irq_install(slot, channel, handler)  vectored IRQ, enabled
+ *   hal_irq_enable(channel)
+ *   hal_irq_disable(channel)
+ *   hal_irq_end()                last statement of every handler
+ *
+ * RTC
+ *   hal_rtc_init()               run from the 32.768 kHz oscillator
+ *   hal_rtc_count()              CTC
+ *
+ * hal_idle()                     called by the main loop when it
+ *                                polls, the host advances its clock
+ * hal_sleep()                    idle the core until an interrupt
+ *                                (PCON idle mode), the host runs its
+ *                                clock to the next event
+ */
+
+// hal_uart_int_id() values (U0IIR)
+#define HAL_IIR_NONE 0x01
+#define HAL_IIR_MASK 0x0E
+#define HAL_IIR_THRE 0x02
+#define HAL_IIR_RDA 0x04
+#define HAL_IIR_CTI 0x0C
+#define HAL_UART_FIFO 16 // characters the transmitter takes when empty
+
+/*
+ * a library service that takes a timer for itself (delay.c, wheel.c)
+ * names its VIC channel with HAL_TIMER_OWNER(channel), two services
+ * on the same timer are then a multiply defined symbol at link time
+ */
+#define HAL_OWNER_CAT(a, b) HAL_OWNER_CAT2(a, b)
+#define HAL_OWNER_CAT2(a, b) a ## b
+#define HAL_TIMER_OWNER(channel) const char HAL_OWNER_CAT(hal_timer_owner_vic, channel) = 1
+
+void hal_gpio_output(int, unsigned long);
+void hal_spi_init(int);
+void hal_uart_init(unsigned int);
+
+#endif // __HAL_H
@@ -0,0 +1,639 @@
+/*****************************************************************
+*
+*                          Function hal_host.c
+*
+*  host (Linux) backend of hal.h
+*
+*  - a simulated clock counts PCLK ticks, it only moves when the
+*    program polls (hal_idle(), hal_spi_done()) or calls
+*    hal_host_run(), so every run with the same input is the same
+*  - the timers count on that clock and call their handlers through
+*    the simulated VIC, lower slot first, never nested
+*  - SPI0 takes 16 x divider ticks per word, the words seen at each
+*    LATCH rising edge (P0.3 by default) are decoded as a display
+*    column frame | Row 31:16 | Row 15:0 | Col 15:0 | into
+*    hal_host_display[]
+*  - GPIO pins read back what was written while they are outputs
+*    and 0 while they are inputs
+*  - UART0 output goes to stdout, input comes from the file named
+*    by HAL_HOST_INPUT in the environment, standard input if there
+*    is none, and from hal_host_uart_input(), the receive interrupt
+*    is pending while input is queued, a character is sent as soon
+*    as it is written so the transmit interrupt follows every write
+*  - hal_idle() takes the input that is there without waiting for
+*    more, HAL_HOST_KEY_MS keeps the characters that many simulated
+*    ms apart so a run from a file is the same every time
+*  - hal_idle() ends the program once hal_host_set_limit() ticks
+*    have been simulated, HAL_HOST_SECONDS in the environment sets
+*    the limit of a run
+*
+*  example, in lab183_spi0_led_matrix_tetris:
+*  gcc -DHAL_HOST -I../lpc2138_lib -o tetris
+*      lab_spi0_led_matrix_tetris_rev3.c tetris.c frame.c replay.c
+*      telemetry.c mirror.c spi0.c uart0.c ../lpc2138_lib/format.c
+*      ../lpc2138_lib/lcd.c ../lpc2138_lib/wheel.c
+*      ../lpc2138_lib/hal_host.c
+*  echo affr | HAL_HOST_KEY_MS=200 HAL_HOST_SECONDS=60 ./tetris
+*
+******************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include "hal.h"
+#include "lpc213x_vic.h"
+
+#define HAL_NEVER 0xFFFFFFFFFFFFFFFFULL
+#define HAL_CHANNELS 32
+#define HAL_INPUT_SIZE 256
+#define HAL_SPI_HISTORY 3
+#define HAL_UART_RX_INT 0x01
+#define HAL_UART_TX_INT 0x02
+
+typedef struct {
+	char running;
+	unsigned long prescale;
+	unsigned long pc;
+	unsigned long tc;
+	unsigned long match;
+	unsigned long alarm; // MR1
+	char alarmOn;
+	unsigned long ir;
+} hal_host_timer;
+
+unsigned int hal_host_display[HAL_HOST_COLS];
+unsigned long hal_host_latches; // column frames decoded
+
+static unsigned long long halTime;   // PCLK ticks since start
+static unsigned long long halLimit = HAL_NEVER;
+static char halLimitRead;
+
+static hal_host_timer halTimer[HAL_TIMERS];
+static const int halTimerChannel[HAL_TIMERS] = {VIC_TIMER0, VIC_TIMER1, VIC_PWM0};
+
+static void (*halHandler[HAL_CHANNELS])(void);
+static int halSlot[HAL_CHANNELS];
+static unsigned long halIrqEnable;
+static char halInIrq;
+
+static unsigned long halPort[2];
+static unsigned long halDir[2];
+static int halLatchPort = 0;
+static unsigned long halLatchMask = 0x00000008; // P0.3
+
+static int halSpiDivider = 8;
+static char halSpiBusy;
+static char halSpiFlag;
+static char halSpiInt;
+static unsigned long long halSpiEnd;
+static unsigned int halSpiWord[HAL_SPI_HISTORY]; // last words, oldest first
+
+static char halInput[HAL_INPUT_SIZE];
+static int halInputHead;
+static int halInputTail;
+static int halKeyFd = -1; // key source, -1 = not opened yet, -2 = ended
+static unsigned long long halKeyGap; // ticks between two characters
+static unsigned long long halKeyNext;
+static char halUartIer; // HAL_UART_RX_INT | HAL_UART_TX_INT
+static char halUartThre; // transmitter empty interrupt pending
+
+static char halRtcOn;
+static unsigned long long halRtcStart;
+
+static void hal_host_dispatch(void);
+static int hal_uart_pending(void);
+static void hal_host_keys(void);
+
+/*********************************************
+ * simulated clock
+ *********************************************/
+
+// ticks until the timer passes its match value or reaches its alarm
+static unsigned long long hal_timer_next(hal_host_timer *timer)
+{
+	unsigned long long period = timer->prescale + 1;
+	unsigned long long next;
+
+	if(!timer->running || timer->tc > timer->match){
+		return HAL_NEVER;
+	}
+	next = (timer->match - timer->tc) * period + (period - timer->pc);
+	if(timer->alarmOn && timer->tc < timer->alarm &&
+	   (timer->alarm - timer->tc) * period - timer->pc < next){
+		next = (timer->alarm - timer->tc) * period - timer->pc;
+	}
+	return next;
+}
+
+static void hal_timer_advance(hal_host_timer *timer, unsigned long long ticks)
+{
+	unsigned long long total;
+	unsigned long period = timer->prescale + 1;
+	unsigned long start = timer->tc;
+
+	if(!timer->running){
+		return;
+	}
+	total = timer->pc + ticks;
+	timer->pc = (unsigned long) (total % period);
+	timer->tc += (unsigned long) (total / period);
+	if(timer->alarmOn && start < timer->alarm && timer->tc >= timer->alarm){
+		timer->ir |= 0x2; // interrupt on MR1
+	}
+	if(timer->tc == timer->match + 1){
+		timer->tc = 0;   // reset on MR0
+		timer->ir |= 0x1; // interrupt on MR0
+	}
+}
+
+/*
+ * advance the clock to time, stopping at every timer match and
+ * SPI transfer end to run the interrupt handlers
+ */
+static void hal_host_run_to(unsigned long long time)
+{
+	unsigned long long next, event;
+	int index;
+
+	while(halTime < time){
+		next = time;
+		for(index = 0; index < HAL_TIMERS; index++){
+			event = hal_timer_next(&halTimer[index]);
+			if(event != HAL_NEVER && halTime + event < next){
+				next = halTime + event;
+			}
+		}
+		if(halSpiBusy && halSpiEnd < next){
+			next = halSpiEnd;
+		}
+		for(index = 0; index < HAL_TIMERS; index++){
+			hal_timer_advance(&halTimer[index], next - halTime);
+		}
+		halTime = next;
+		if(halSpiBusy && halTime >= halSpiEnd){
+			halSpiBusy = 0;
+			halSpiFlag = 1;
+		}
+		hal_host_dispatch();
+	}
+}
+
+void hal_host_run(unsigned long long ticks)
+{
+	hal_host_run_to(halTime + ticks);
+}
+
+unsigned long long hal_host_time(void)
+{
+	return halTime;
+}
+
+void hal_host_set_limit(unsigned long long ticks)
+{
+	halLimit = ticks;
+	halLimitRead = 1;
+}
+
+/*
+ * let the clock run to the next event, the main loop of the
+ * program is the only thing that waits on the host
+ */
+void hal_idle(void)
+{
+	unsigned long long next = HAL_NEVER;
+	unsigned long long event;
+	char *seconds;
+	int index;
+
+	if(!halLimitRead){
+		halLimitRead = 1;
+		seconds = getenv("HAL_HOST_SECONDS");
+		if(seconds){
+			halLimit = (unsigned long long) atol(seconds) * HAL_PCLK;
+		}
+	}
+	if(halTime >= halLimit){
+		fflush(stdout);
+		exit(0);
+	}
+	hal_host_keys();
+	for(index = 0; index < HAL_TIMERS; index++){
+		event = hal_timer_next(&halTimer[index]);
+		if(event < next){
+			next = event;
+		}
+	}
+	if(halSpiBusy && halSpiEnd - halTime < next){
+		next = halSpiEnd - halTime;
+	}
+	if(next == HAL_NEVER || next == 0){
+		next = 1;
+	}
+	if(halTime + next > halLimit){
+		next = halLimit - halTime;
+	}
+	hal_host_run_to(halTime + next);
+}
+
+// the core would stop until an interrupt, the clock runs to it
+void hal_sleep(void)
+{
+	hal_idle();
+}
+
+/*********************************************
+ * VIC
+ *********************************************/
+
+static int hal_irq_pending(int channel)
+{
+	int index;
+
+	for(index = 0; index < HAL_TIMERS; index++){
+		if(halTimerChannel[index] == channel){
+			return halTimer[index].ir & 0x3;
+		}
+	}
+	if(channel == VIC_SPI){
+		return halSpiFlag && halSpiInt;
+	}
+	if(channel == VIC_UART0){
+		return hal_uart_pending() != HAL_IIR_NONE;
+	}
+	return 0;
+}
+
+// run the pending enabled handlers, lowest vector slot first
+static void hal_host_dispatch(void)
+{
+	int channel, best;
+	int count = 0;
+
+	if(halInIrq){
+		return;
+	}
+	do{
+		best = -1;
+		for(channel = 0; channel < HAL_CHANNELS; channel++){
+			if((halIrqEnable & (1UL << channel)) && halHandler[channel] &&
+			   hal_irq_pending(channel)){
+				if(best < 0 || halSlot[channel] < halSlot[best]){
+					best = channel;
+				}
+			}
+		}
+		if(best >= 0){
+			halInIrq = 1;
+			halHandler[best]();
+			halInIrq = 0;
+		}
+		// a handler that never clears its flag would hang the host
+		if(++count > HAL_CHANNELS * 4){
+			fprintf(stderr, "hal_host: IRQ %d not cleared\n", best);
+			exit(1);
+		}
+	}while(best >= 0);
+}
+
+void hal_irq_install(int slot, int channel, void (*handler)(void))
+{
+	halHandler[channel] = handler;
+	halSlot[channel] = slot;
+	halIrqEnable |= 1UL << channel;
+}
+
+void hal_irq_enable(int channel)
+{
+	halIrqEnable |= 1UL << channel;
+	hal_host_dispatch();
+}
+
+void hal_irq_disable(int channel)
+{
+	halIrqEnable &= ~(1UL << channel);
+}
+
+void hal_irq_end(void)
+{
+}
+
+/*********************************************
+ * GPIO
+ *********************************************/
+
+// column frame = | Row 31:16 | Row 15:0 | Col 15:0 |
+static void hal_host_latch(void)
+{
+	int col;
+
+	for(col = 0; col < HAL_HOST_COLS; col++){
+		if(halSpiWord[2] & (1 << col)){
+			hal_host_display[col] = (halSpiWord[0] << 16) | halSpiWord[1];
+		}
+	}
+	hal_host_latches++;
+}
+
+void hal_host_set_latch(int port, unsigned long mask)
+{
+	halLatchPort = port;
+	halLatchMask = mask;
+}
+
+void hal_gpio_output(int port, unsigned long mask)
+{
+	halDir[port] |= mask;
+}
+
+void hal_gpio_set(int port, unsigned long mask)
+{
+	if(port == halLatchPort && (mask & halLatchMask & ~halPort[port])){
+		hal_host_latch();
+	}
+	halPort[port] |= mask;
+}
+
+void hal_gpio_clr(int port, unsigned long mask)
+{
+	halPort[port] &= ~mask;
+}
+
+// pins that are not outputs read low, an idle LCD is not busy
+unsigned long hal_gpio_read(int port)
+{
+	return halPort[port] & halDir[port];
+}
+
+void hal_gpio_input(int port, unsigned long mask)
+{
+	halDir[port] &= ~mask;
+}
+
+/*********************************************
+ * SPI0
+ *********************************************/
+
+void hal_spi_init(int divider)
+{
+	halSpiDivider = divider;
+	halSpiBusy = 0;
+	halSpiFlag = 0;
+	halSpiInt = 0;
+}
+
+void hal_spi_write(unsigned int data)
+{
+	int index;
+
+	for(index = 0; index < HAL_SPI_HISTORY - 1; index++){
+		halSpiWord[index] = halSpiWord[index + 1];
+	}
+	halSpiWord[HAL_SPI_HISTORY - 1] = data & 0xFFFF;
+	halSpiFlag = 0;
+	halSpiBusy = 1;
+	halSpiEnd = halTime + 16 * halSpiDivider;
+}
+
+unsigned int hal_spi_read(void)
+{
+	halSpiFlag = 0;
+	return 0; // MISO is not connected
+}
+
+// polling the status waits for the word on the host
+int hal_spi_done(void)
+{
+	if(halSpiBusy){
+		hal_host_run_to(halSpiEnd);
+	}
+	return halSpiFlag;
+}
+
+void hal_spi_int_enable(void)
+{
+	halSpiInt = 1;
+}
+
+void hal_spi_int_disable(void)
+{
+	halSpiInt = 0;
+}
+
+void hal_spi_int_clear(void)
+{
+}
+
+/*********************************************
+ * UART0
+ *********************************************/
+
+void hal_uart_init(unsigned int baudrate)
+{
+	(void) baudrate; // characters take no time on the host
+	// input queued before now stays, it has been received
+	halUartIer = 0;
+	halUartThre = 0;
+}
+
+int hal_uart_tx_ready(void)
+{
+	return 1;
+}
+
+void hal_uart_write(int ch)
+{
+	putchar(ch);
+	halUartThre = 1;
+}
+
+int hal_uart_rx_ready(void)
+{
+	return halInputHead != halInputTail;
+}
+
+int hal_uart_read(void)
+{
+	int ch = 0;
+
+	if(halInputHead != halInputTail){
+		ch = (unsigned char) halInput[halInputTail];
+		halInputTail = (halInputTail + 1) % HAL_INPUT_SIZE;
+	}
+	return ch;
+}
+
+void hal_uart_rx_int_enable(void)
+{
+	halUartIer |= HAL_UART_RX_INT;
+	hal_host_dispatch();
+}
+
+void hal_uart_rx_int_disable(void)
+{
+	halUartIer &= ~HAL_UART_RX_INT;
+}
+
+void hal_uart_tx_int_enable(void)
+{
+	halUartIer |= HAL_UART_TX_INT;
+	hal_host_dispatch();
+}
+
+void hal_uart_tx_int_disable(void)
+{
+	halUartIer &= ~HAL_UART_TX_INT;
+}
+
+// received data first, like the UART
+static int hal_uart_pending(void)
+{
+	if((halUartIer & HAL_UART_RX_INT) && halInputHead != halInputTail){
+		return HAL_IIR_RDA;
+	}
+	if((halUartIer & HAL_UART_TX_INT) && halUartThre){
+		return HAL_IIR_THRE;
+	}
+	return HAL_IIR_NONE;
+}
+
+int hal_uart_int_id(void)
+{
+	int id = hal_uart_pending();
+
+	if(id == HAL_IIR_THRE){
+		halUartThre = 0; // cleared by reading the IIR
+	}
+	return id;
+}
+
+/*
+ * the key source, what has come in so far, one character every
+ * HAL_HOST_KEY_MS if that is set, the source is closed at its end
+ */
+static void hal_host_keys(void)
+{
+	struct pollfd ready;
+	char *name, *ms;
+	char ch;
+
+	if(halKeyFd == -1){
+		name = getenv("HAL_HOST_INPUT");
+		halKeyFd = name ? open(name, O_RDONLY) : STDIN_FILENO;
+		if(halKeyFd < 0){
+			perror(name);
+			exit(2);
+		}
+		ms = getenv("HAL_HOST_KEY_MS");
+		if(ms){
+			halKeyGap = (unsigned long long) atol(ms) * (HAL_PCLK / 1000);
+		}
+	}
+	while(halKeyFd >= 0 && halTime >= halKeyNext &&
+	      (halInputHead + 1) % HAL_INPUT_SIZE != halInputTail){
+		ready.fd = halKeyFd;
+		ready.events = POLLIN;
+		if(poll(&ready, 1, 0) <= 0){
+			return; // nothing yet, a terminal or a pipe
+		}
+		if(read(halKeyFd, &ch, 1) != 1){
+			if(halKeyFd != STDIN_FILENO){
+				close(halKeyFd);
+			}
+			halKeyFd = -2;
+			return;
+		}
+		halInput[halInputHead] = ch;
+		halInputHead = (halInputHead + 1) % HAL_INPUT_SIZE;
+		halKeyNext = halTime + halKeyGap;
+	}
+}
+
+// queue characters as if they had been received
+void hal_host_uart_input(const char *str)
+{
+	while(*str && (halInputHead + 1) % HAL_INPUT_SIZE != halInputTail){
+		halInput[halInputHead] = *str++;
+		halInputHead = (halInputHead + 1) % HAL_INPUT_SIZE;
+	}
+}
+
+/*********************************************
+ * timers
+ *********************************************/
+
+void hal_timer_start(int timer, unsigned long prescale, unsigned long match)
+{
+	halTimer[timer].prescale = prescale;
+	halTimer[timer].match = match;
+	halTimer[timer].pc = 0;
+	halTimer[timer].tc = 0;
+	halTimer[timer].running = 1;
+}
+
+void hal_timer_stop(int timer)
+{
+	halTimer[timer].running = 0;
+	halTimer[timer].pc = 0;
+	halTimer[timer].tc = 0;
+	halTimer[timer].ir = 0;
+}
+
+void hal_timer_set_match(int timer, unsigned long match)
+{
+	halTimer[timer].match = match;
+}
+
+unsigned long hal_timer_match(int timer)
+{
+	return halTimer[timer].match;
+}
+
+unsigned long hal_timer_count(int timer)
+{
+	return halTimer[timer].tc;
+}
+
+unsigned long hal_timer_prescale_count(int timer)
+{
+	return halTimer[timer].pc;
+}
+
+void hal_timer_clear_int(int timer)
+{
+	halTimer[timer].ir &= ~0x1;
+}
+
+void hal_timer_set_alarm(int timer, unsigned long count)
+{
+	halTimer[timer].alarm = count;
+	halTimer[timer].alarmOn = 1;
+}
+
+void hal_timer_alarm_off(int timer)
+{
+	halTimer[timer].alarmOn = 0;
+	halTimer[timer].ir &= ~0x2;
+}
+
+/*********************************************
+ * RTC
+ *********************************************/
+
+void hal_rtc_init(void)
+{
+	if(!halRtcOn){
+		halRtcOn = 1;
+		halRtcStart = halTime;
+	}
+}
+
+// CTC bit 15:1 = 32.768 kHz prescaler
+unsigned long hal_rtc_count(void)
+{
+	if(!halRtcOn){
+		return 0;
+	}
+	return (unsigned long) (((halTime - halRtcStart) * 32768 / HAL_PCLK) & 0x7FFF) << 1;
+}
@@ -0,0 +1,75 @@
+/*****************************************************************
+*
+*                          Function hal_host.h
+*
+*  host (Linux) backend of hal.h, see hal_host.c
+*
+******************************************************************/
+
+#ifndef __HAL_HOST_H
+#define __HAL_HOST_H
+
+// Keil interrupt keyword, handlers are plain functions on the host
+#define __irq
+
+#define HAL_TIMER0 0
+#define HAL_TIMER1 1
+#define HAL_PWM 2
+#define HAL_TIMERS 3
+
+// decoded display, bit n of column c = row n, see hal_host.c
+#define HAL_HOST_COLS 16
+extern unsigned int hal_host_display[HAL_HOST_COLS];
+extern unsigned long hal_host_latches;
+
+void hal_gpio_set(int, unsigned long);
+void hal_gpio_clr(int, unsigned long);
+unsigned long hal_gpio_read(int);
+void hal_gpio_input(int, unsigned long);
+
+void hal_spi_write(unsigned int);
+unsigned int hal_spi_read(void);
+int hal_spi_done(void);
+void hal_spi_int_enable(void);
+void hal_spi_int_disable(void);
+void hal_spi_int_clear(void);
+
+int hal_uart_tx_ready(void);
+void hal_uart_write(int);
+int hal_uart_rx_ready(void);
+int hal_uart_read(void);
+void hal_uart_rx_int_enable(void);
+void hal_uart_rx_int_disable(void);
+void hal_uart_tx_int_enable(void);
+void hal_uart_tx_int_disable(void);
+int hal_uart_int_id(void);
+
+void hal_timer_start(int, unsigned long, unsigned long);
+void hal_timer_stop(int);
+void hal_timer_set_match(int, unsigned long);
+unsigned long hal_timer_match(int);
+unsigned long hal_timer_count(int);
+unsigned long hal_timer_prescale_count(int);
+void hal_timer_clear_int(int);
+void hal_timer_set_alarm(int, unsigned long);
+void hal_timer_alarm_off(int);
+
+void hal_irq_install(int, int, void (*)(void));
+void hal_irq_enable(int);
+void hal_irq_disable(int);
+void hal_irq_end(void);
+
+void hal_rtc_init(void);
+unsigned long hal_rtc_count(void);
+
+void hal_idle(void);
+void hal_sleep(void);
+
+// host only
+void hal_host_run(unsigned long long);
+unsigned long long hal_host_time(void);
+void hal_host_set_limit(unsigned long long);
+void hal_host_set_latch(int, unsigned long);
+void hal_host_uart_input(const char *);
+
+#endif // __HAL_HOST_H
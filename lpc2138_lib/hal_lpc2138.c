@@ -0,0 +1,84 @@
+/*****************************************************************
+*
+*                          Function hal_lpc2138.c
+*
+*  LPC2138 backend of hal.h, pin and peripheral set up
+*
+******************************************************************/
+
+#include "hal.h"
+
+/*
+ * select GPIO for the pins in mask and make them outputs
+ */
+void hal_gpio_output(int port, unsigned long mask)
+{
+	int pin;
+
+	if(port){
+		// P1.16-P1.25 are GPIO unless the trace port is on,
+		// P1.26-P1.31 unless the debug port is on
+		if(mask & 0x03FF0000){
+			PINSEL2 &= ~0x08;
+		}
+		if(mask & 0xFC000000){
+			PINSEL2 &= ~0x04;
+		}
+		IO1DIR |= mask;
+	}
+	else{
+		// 2 PINSEL bits per pin, 00 = GPIO
+		for(pin = 0; pin < 16; pin++){
+			if(mask & (1UL << pin)){
+				PINSEL0 &= ~(3UL << (pin << 1));
+			}
+			if(mask & (1UL << (pin + 16))){
+				PINSEL1 &= ~(3UL << (pin << 1));
+			}
+		}
+		IO0DIR |= mask;
+	}
+}
+
+void hal_spi_init(int divider)
+{
+	PCONP   |= 0x00000100;   // SPI Interface Enable
+	// Select P0.4 as SCLK, P0.5 as MISO, P0.6 as MOSI
+	PINSEL0 &= ~(0x3F00);
+	PINSEL0 |= (1 << 8) | (1 << 10) | (1 << 12);
+
+	// set up S0SPCR using the following settings
+		// BitEnable = 1, 16-bit format
+		// CPHA = 0 = Rising Clock Shift Data,
+		// CPOL = 0 = Normal Clock
+		// MSTR = 1 = Master
+		// LSBF = 0 = MSB First
+		// SPIE = 0 = Disable SPI Interrupt
+	S0SPCR = 0x24;
+
+	S0SPCCR = divider;    // SPI clock rate = PCLK/divider
+}
+
+void hal_uart_init(unsigned int baudrate)
+{
+  unsigned short u0dl;
+  PINSEL0 &= 0xFFFFFFF0; // Reset P0.0,P0.1 Pin Config
+  PINSEL0 |= 0x00000001; // P0.0 = TxD0
+  PINSEL0 |= 0x00000004; // P0.1 = RxD0
+
+  U0LCR &= 0xFC; // Reset Word Select
+  U0LCR |= 0x03; // World Lenght = 8 bit
+  U0LCR &= 0xFB; // Stop Bit = 1 bit
+  U0LCR &= 0xF7; // Disable Parity
+  U0LCR &= 0xBF; // Disable Break Control
+  U0LCR |= 0x80; // Enable Divisor Latch Access Bit
+
+  u0dl = HAL_PCLK / (baudrate << 4);// u0dl = PCLK/(16 x Buad)
+  U0DLL = u0dl & 0xFF;
+  U0DLM = (u0dl >> 8);
+
+  U0LCR &= 0x7F; // Disable Divisor Latch Access Bit
+  U0FCR |= 0x01; // FIF0 Enable
+  U0FCR |= 0x02; // RX FIFO Reset
+  U0FCR |= 0x04; // TX FIFO Reset
+}
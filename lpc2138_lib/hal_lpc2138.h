@@ -0,0 +1,96 @@
+/*****************************************************************
+*
+*                          Function hal_lpc2138.h
+*
+*  LPC2138 backend of hal.h, the run-time calls are register
+*  macros so interrupt handlers pay nothing for the layer
+*
+******************************************************************/
+
+#ifndef __HAL_LPC2138_H
+#define __HAL_LPC2138_H
+
+#include <LPC213X.h>
+
+#define HAL_CAT(a, b) HAL_CAT2(a, b)
+#define HAL_CAT2(a, b) a ## b
+
+// timer ids are the register name prefixes
+#define HAL_TIMER0 T0
+#define HAL_TIMER1 T1
+#define HAL_PWM PWM
+
+// S0SPSR / S0SPCR bit
+#define HAL_SPIF 0x80
+#define HAL_SPIE 0x80
+
+// U0LSR bits
+#define HAL_RDR 0x01
+#define HAL_THRE 0x20
+
+// U0IER bits
+#define HAL_RBRIE 0x01
+#define HAL_THREIE 0x02
+
+// GPIO
+#define hal_gpio_set(port, mask) ((port) ? (IO1SET = (mask)) : (IO0SET = (mask)))
+#define hal_gpio_clr(port, mask) ((port) ? (IO1CLR = (mask)) : (IO0CLR = (mask)))
+#define hal_gpio_read(port) ((port) ? IO1PIN : IO0PIN)
+#define hal_gpio_input(port, mask) ((port) ? (IO1DIR &= ~(mask)) : (IO0DIR &= ~(mask)))
+
+// SPI0
+#define hal_spi_write(data) (S0SPDR = (data))
+#define hal_spi_read() (S0SPDR)
+#define hal_spi_done() (S0SPSR & HAL_SPIF)
+#define hal_spi_int_enable() (S0SPCR |= HAL_SPIE)
+#define hal_spi_int_disable() (S0SPCR &= ~HAL_SPIE)
+#define hal_spi_int_clear() (S0SPINT = 0x01)
+
+// UART0
+#define hal_uart_tx_ready() (U0LSR & HAL_THRE)
+#define hal_uart_write(ch) (U0THR = (ch))
+#define hal_uart_rx_ready() (U0LSR & HAL_RDR)
+#define hal_uart_read() (U0RBR)
+#define hal_uart_rx_int_enable() (U0IER |= HAL_RBRIE)
+#define hal_uart_rx_int_disable() (U0IER &= ~HAL_RBRIE)
+#define hal_uart_tx_int_enable() (U0IER |= HAL_THREIE)
+#define hal_uart_tx_int_disable() (U0IER &= ~HAL_THREIE)
+#define hal_uart_int_id() (U0IIR)
+
+// timers, TCR 0x2 = reset and hold, 0x1 = run
+// MCR bit 0 = interrupt on MR0, bit 1 = reset on MR0, bit 3 = interrupt on MR1
+#define hal_timer_start(timer, prescale, match) {     \
+	HAL_CAT(timer, TCR) = 0x2;                            \
+	HAL_CAT(timer, PR) = (prescale);                      \
+	HAL_CAT(timer, MR0) = (match);                        \
+	HAL_CAT(timer, MCR) = (HAL_CAT(timer, MCR) & ~0x7) | 0x3; \
+	HAL_CAT(timer, TCR) = 0x1;                            \
+}
+#define hal_timer_stop(timer) {HAL_CAT(timer, TCR) = 0x2; HAL_CAT(timer, IR) = 0x1;}
+#define hal_timer_set_match(timer, match) (HAL_CAT(timer, MR0) = (match))
+#define hal_timer_match(timer) (HAL_CAT(timer, MR0))
+#define hal_timer_count(timer) (HAL_CAT(timer, TC))
+#define hal_timer_prescale_count(timer) (HAL_CAT(timer, PC))
+#define hal_timer_clear_int(timer) (HAL_CAT(timer, IR) = 0x1)
+#define hal_timer_set_alarm(timer, count) {HAL_CAT(timer, MR1) = (count); HAL_CAT(timer, MCR) |= 0x8;}
+#define hal_timer_alarm_off(timer) {HAL_CAT(timer, MCR) &= ~0x8; HAL_CAT(timer, IR) = 0x2;}
+
+// VIC, slot is a constant 0-15
+#define hal_irq_install(slot, channel, handler) {             \
+	VICIntSelect &= ~(1 << (channel)); /* vectored IRQ */        \
+	HAL_CAT(VICVectAddr, slot) = (unsigned int) (handler);      \
+	HAL_CAT(VICVectCntl, slot) = 0x20 | (channel);              \
+	VICIntEnable = (1 << (channel));                            \
+}
+#define hal_irq_enable(channel) (VICIntEnable = (1 << (channel)))
+#define hal_irq_disable(channel) (VICIntEnClr = (1 << (channel)))
+#define hal_irq_end() (VICVectAddr = 0)
+
+// RTC, CLKEN and clock from the 32.768 kHz oscillator
+#define hal_rtc_init() (CCR = 0x11)
+#define hal_rtc_count() (CTC)
+
+#define hal_idle()
+#define hal_sleep() (PCON = 0x01) // idle mode, peripherals keep running
+
+#endif // __HAL_LPC2138_H
@@ -1,14 +1,66 @@
-#include <LPC213X.h>
 #include "lcd.h"
 
+#define LCD_LOOPS_PER_US 12   // lcd_wait_us() loops before calibration
+#define LCD_CAL_LOOPS 1000    // loops timed by lcd_init()
+#define LCD_POLL_US 4         // one busy flag read, two enable pulses
+
+char lcd_no_busy;             // controller never answered, wait instead
+static unsigned int lcdLoopsPerUs = LCD_LOOPS_PER_US;
+
+// shadow framebuffer, cell = row * LCD_COLS + column
+#define LCD_CELLS (LCD_ROWS * LCD_COLS)
+#define LCD_CG_BYTES (LCD_GLYPHS * 8)	// CG RAM, 8 rows per glyph
+#define LCD_CG_CURSOR 0x100		// lcdCursor of CG RAM address 0
+static volatile char lcdFb[LCD_CELLS];	// written by the program
+static char lcdSent[LCD_CELLS];		// on the display, lcd_fb_tick() only
+static volatile unsigned char lcdCg[LCD_CG_BYTES];	// glyph rows, 0xFF = free slot
+static unsigned char lcdCgSent[LCD_CG_BYTES];	// in CG RAM, 0xFF = unknown
+static volatile char lcdCgDirty;	// lcdCg has changed
+static unsigned int lcdGlyphUse[LCD_GLYPHS];	// lcd_glyph() call of the last use
+static unsigned int lcdGlyphClock;
+static int lcdCursor;			// address of the next data, DD RAM or
+					// LCD_CG_CURSOR + CG RAM, -1 unknown
+static int lcdScan;			// cell the search starts at
+static int lcdTarget;			// cell or LCD_CELLS + CG RAM byte being
+					// sent, -1 for an address
+static unsigned char lcdByte;		// byte being sent
+static char lcdLowNibble;		// high nibble sent, low one is next
 
 // xxxx xxx0 0000 0000 0000 0000 0000 0000
 
+/* Calibrated Delay, at least us microseconds */
+void lcd_wait_us(unsigned int us)
+{
+  volatile unsigned int i;		// kept by the optimizer
+  unsigned int count = us * lcdLoopsPerUs;
+
+  for (i=0;i<count;i++);
+}
+
+/* Loops of lcd_wait_us() per microsecond, timed on LCD_TIMER
+ * the loops are timed between two reads so the timer start is left
+ * out, and the result is rounded up, a wait may be long, not short
+ */
+static void lcd_calibrate(void)
+{
+  volatile unsigned int i;
+  unsigned long start, ticks;
+  unsigned long num = LCD_CAL_LOOPS * (HAL_PCLK / 100);	// PCLK is a multiple of 100
+
+  hal_timer_start(LCD_TIMER, 0, 0xFFFFFFFF);	// count PCLK
+  start = hal_timer_count(LCD_TIMER);
+  for (i=0;i<LCD_CAL_LOOPS;i++);
+  ticks = hal_timer_count(LCD_TIMER) - start;
+  hal_timer_stop(LCD_TIMER);
+  if (ticks == 0) return;		// timer not counting, keep the default
+  lcdLoopsPerUs = (num + ticks * 10000 - 1) / (ticks * 10000);
+}
+
 /* Strobe 4-Bit Data to LCD */
 void lcd_out_data4(unsigned char val)
 {  
-  IO1CLR = (LCD_DATA);	  	// Reset 4-Bit Pin Data
-  IO1SET = (val<<28);		// write data to P1.31-P1.28
+  hal_gpio_clr(1, LCD_DATA);	  	// Reset 4-Bit Pin Data
+  hal_gpio_set(1, (unsigned long) val<<28);		// write data to P1.31-P1.28
 }
 
 /* Write Data 1 Byte to LCD */
@@ -20,7 +72,7 @@ void lcd_write_byte(unsigned char val)
   lcd_out_data4(val&0x0F);		// Strobe 4-Bit Low-Nibble to LCD
   enable_lcd();				// Enable Pulse  
 
-  while(busy_lcd());      		// Wait LCD Execute Complete  
+  lcd_wait_ready(LCD_EXEC_US);		// Wait LCD Execute Complete  
 }
 
 /* Write Instruction to LCD */
@@ -28,6 +80,10 @@ void lcd_write_control(unsigned char val)
 { 
   lcd_rs_clr();				// RS = 0 = Instruction Select
   lcd_write_byte(val);			// Strobe Command Byte	    
+  if (lcd_no_busy && val <= 0x03)	// Clear and Home take longer
+  {
+    lcd_wait_us(LCD_CLEAR_US - LCD_EXEC_US);
+  }
 }
 
 /* Write Data(ASCII) to LCD */
@@ -40,31 +96,33 @@ void lcd_write_ascii(unsigned char c)
 /* Initial 4-Bit LCD Interface */
 void lcd_init(void)
 {
-  unsigned int i;			// Delay Count
-  PINSEL2 = 0;		      // P1[31..25] as GPIO
-  IO1DIR |= 0xFE000000; // P1[31..25] = Output
-  for (i=0;i<50000;i++);	// Power-On Delay (15 mS)
+  lcd_calibrate();			// lcd_wait_us() from LCD_TIMER
+  lcd_no_busy = 0;
+  hal_gpio_output(1, LCD_IOALL); // P1[31..25] = GPIO Output
+  lcd_wait_us(15000);			// Power-On Delay (15 mS)
 
-  IO1CLR = (LCD_IOALL);	     // Reset (4-Bit Data,EN,RW,RS) Pin
-  IO1SET = (LCD_D5|LCD_D4);  // write 0011
+  // the busy flag cannot be read until the interface is set
+  hal_gpio_clr(1, LCD_IOALL);	     // Reset (4-Bit Data,EN,RW,RS) Pin
+  hal_gpio_set(1, LCD_D5|LCD_D4);  // write 0011
   enable_lcd();		         // Enable Pulse
-  for (i=0;i<10000;i++);    // Delay 4.1mS
+  lcd_wait_us(4100);	    // Delay 4.1mS
 
-  IO1CLR = (LCD_IOALL);	     // Reset (4-Bit Data,EN,RW,RS) Pin
-  IO1SET = (LCD_D5|LCD_D4);  // write 0011
+  hal_gpio_clr(1, LCD_IOALL);	     // Reset (4-Bit Data,EN,RW,RS) Pin
+  hal_gpio_set(1, LCD_D5|LCD_D4);  // write 0011
   enable_lcd();		          // Enable Pulse
-  for (i=0;i<100;i++);	      // delay 100uS
+  lcd_wait_us(100);	      // delay 100uS
 
-  IO1CLR = (LCD_IOALL);	     // Reset (4-Bit Data,EN,RW,RS) Pin
-  IO1SET = (LCD_D5|LCD_D4);  // write 0011
+  hal_gpio_clr(1, LCD_IOALL);	     // Reset (4-Bit Data,EN,RW,RS) Pin
+  hal_gpio_set(1, LCD_D5|LCD_D4);  // write 0011
   enable_lcd();		          // Enable Pulse
-  while(busy_lcd());         // Wait LCD Execute Complete
+  lcd_wait_us(100);         // Wait LCD Execute Complete
  
-  IO1CLR = (LCD_IOALL);	   // Reset (4-Bit Data,EN,RW,RS) Pin
-  IO1SET = (LCD_D5);	   // write 0010
+  hal_gpio_clr(1, LCD_IOALL);	   // Reset (4-Bit Data,EN,RW,RS) Pin
+  hal_gpio_set(1, LCD_D5);	   // write 0010
   enable_lcd();		       // Enable Pulse
-  while(busy_lcd());      // Wait LCD Execute Complete
+  lcd_wait_us(100);       // Wait LCD Execute Complete
   
+  // 4-bit interface from here, the busy flag can be read
   // Function Set (DL=0 4-Bit,N=1 2 Line,F=0 5X7)
   lcd_write_control(0x28);
   // Display on,Cursor on, Cursor not Blink)
@@ -73,7 +131,6 @@ void lcd_init(void)
   lcd_write_control(0x06);
   // Clear Display,Set DD RAM Address=0
   lcd_write_control(0x01);     
-  for (i=0;i<100000;i++);     // Wait Command Ready
 }
 
 /* Set LCD Position Cursor */
@@ -106,19 +163,58 @@ void lcd_print_string(char* str)
   }
 }
 
-/* Wait LCD Ready */
+/* Read Busy Flag, 1 = busy
+ * D7 of the high nibble, the low nibble (address) is clocked out too
+ */
 char busy_lcd(void)
 {
-  delay(1000);
-  return 0;
+  unsigned long pins;
+  unsigned long rs = hal_gpio_read(1) & LCD_RS;
+
+  hal_gpio_input(1, LCD_DATA);		// P1.31-P1.28 = Input
+  lcd_rs_clr();				// RS = 0, RW = 1 = Read Status
+  lcd_rw_set();
+  lcd_en_set();				// High Nibble
+  lcd_wait_us(1);			// data valid 360 nS after EN
+  pins = hal_gpio_read(1);
+  lcd_en_clr();
+  lcd_wait_us(1);
+  lcd_en_set();				// Low Nibble
+  lcd_wait_us(1);
+  lcd_en_clr();
+  lcd_rw_clr();				// RW = 0 = Write
+  hal_gpio_output(1, LCD_DATA);		// P1.31-P1.28 = Output
+  if (rs) lcd_rs_set();			// restore Data Select
+  return ((pins & LCD_D7) ? 1 : 0);
+}
+
+/* Wait LCD Ready
+ * polls the busy flag for up to LCD_BUSY_TIMEOUT_US, a controller
+ * that never gets ready (RW tied low) switches the driver to fixed
+ * delays of us from then on
+ */
+void lcd_wait_ready(unsigned int us)
+{
+  int polls;
+
+  if (lcd_no_busy)
+  {
+    lcd_wait_us(us);
+    return;
+  }
+  for (polls = 0; polls < LCD_BUSY_TIMEOUT_US / LCD_POLL_US; polls++)
+  {
+    if (!busy_lcd()) return;
+  }
+  lcd_no_busy = 1;
+  lcd_wait_us(LCD_CLEAR_US);		// whatever it was doing is done
 }
 
 /* Enable Pulse to LCD */
 void enable_lcd(void)	 		// Enable Pulse
 {
-  unsigned int i;			// Delay Count
   lcd_en_set();  			// Enable ON
-  for (i=0;i<50;i++);
+  lcd_wait_us(1);			// 450 nS at least
   lcd_en_clr();  			// Enable OFF 
 }
 
@@ -127,3 +223,195 @@ void delay(unsigned long int count1)
 {
   while(count1 > 0) {count1--;}		// Loop Decrease Counter	
 }
+
+/*********************************************
+ * shadow framebuffer
+ *********************************************/
+
+// DD RAM address of a cell
+static int lcd_fb_addr(int cell)
+{
+  return ((cell >= LCD_COLS ? LCD_ROW2_ADDR : 0) + cell % LCD_COLS);
+}
+
+/* Clear Buffer, lcd_init() has cleared the display */
+void lcd_fb_init(void)
+{
+  int i;
+
+  for (i=0;i<LCD_CELLS;i++)
+  {
+    lcdFb[i] = ' ';
+    lcdSent[i] = ' ';
+  }
+  for (i=0;i<LCD_CG_BYTES;i++)
+  {
+    lcdCg[i] = 0xFF;
+    lcdCgSent[i] = 0xFF;
+  }
+  for (i=0;i<LCD_GLYPHS;i++)
+  {
+    lcdGlyphUse[i] = 0;
+  }
+  lcdGlyphClock = 0;
+  lcdCgDirty = 0;
+  lcdCursor = 0;			// clear sets DD RAM address 0
+  lcdScan = 0;
+  lcdLowNibble = 0;
+}
+
+/* Write Character, RAM only */
+void lcd_fb_putc(int row, int col, char c)
+{
+  if (row < 0 || row >= LCD_ROWS || col < 0 || col >= LCD_COLS) return;
+  lcdFb[row * LCD_COLS + col] = c;
+}
+
+/* Write String up to the end of the row, RAM only
+ * return: characters written
+ */
+int lcd_fb_print(int row, int col, const char* str)
+{
+  int i;
+
+  if (row < 0 || row >= LCD_ROWS || col < 0) return 0;
+  for (i=0;col+i<LCD_COLS && str[i]!=0;i++)
+  {
+    lcdFb[row * LCD_COLS + col + i] = str[i];
+  }
+  return i;
+}
+
+/* CG RAM Character for a 5x8 Bitmap, 8 rows top first, bit 4 = left
+ * a slot that holds the same bitmap is used again and nothing is
+ * sent, otherwise the least recently used slot that is not on the
+ * display (any slot if all of them are) gets the bitmap and
+ * lcd_fb_tick() sends the rows that differ
+ * return: character code for lcd_fb_putc() and lcd_fb_print()
+ */
+char lcd_glyph(const unsigned char* bitmap)
+{
+  int slot, row, best, i;
+  unsigned int shown = 0;		// slots used by a cell
+
+  lcdGlyphClock++;
+  for (slot=0;slot<LCD_GLYPHS;slot++)
+  {
+    for (row=0;row<8 && lcdCg[slot*8+row]==(bitmap[row]&0x1F);row++);
+    if (row == 8)			// already there
+    {
+      lcdGlyphUse[slot] = lcdGlyphClock;
+      return LCD_GLYPH_CODE + slot;
+    }
+  }
+  for (i=0;i<LCD_CELLS;i++)
+  {
+    if ((unsigned char) lcdFb[i] < LCD_GLYPH_CODE + LCD_GLYPHS)
+    {
+      shown |= 1 << (lcdFb[i] & (LCD_GLYPHS - 1));
+    }
+  }
+  if (shown == (1 << LCD_GLYPHS) - 1) shown = 0;	// all shown, take the oldest
+  best = -1;
+  for (slot=0;slot<LCD_GLYPHS;slot++)
+  {
+    if (!(shown & (1 << slot)) && (best < 0 || lcdGlyphUse[slot] < lcdGlyphUse[best]))
+    {
+      best = slot;
+    }
+  }
+  for (row=0;row<8;row++)
+  {
+    lcdCg[best*8+row] = bitmap[row] & 0x1F;
+  }
+  lcdGlyphUse[best] = lcdGlyphClock;
+  lcdCgDirty = 1;			// after the rows, lcd_fb_tick() may be waiting
+  return LCD_GLYPH_CODE + best;
+}
+
+/* Send a Nibble
+ * glyph rows go first so a glyph is in CG RAM before a cell shows
+ * it, then the next changed cell is searched from the last one, so a
+ * run of changed cells or rows goes out after one Set Address, a
+ * cell that changes while it is sent stays changed and is sent again
+ * return: 0 when the display matches the buffer
+ */
+int lcd_fb_tick(void)
+{
+  int i, addr;
+  int target = -1;
+
+  if (lcdLowNibble)
+  {
+    lcd_out_data4(lcdByte & 0x0F);	// Low Nibble, RS is still set
+    enable_lcd();
+    lcdLowNibble = 0;
+    if (lcdTarget < 0)			// Set Address
+    {
+      lcdCursor = (lcdByte & 0x80) ? (lcdByte & 0x7F) : LCD_CG_CURSOR + (lcdByte & 0x3F);
+      return 1;
+    }
+    if (lcdTarget < LCD_CELLS)
+    {
+      lcdSent[lcdTarget] = lcdByte;
+    }
+    else
+    {
+      lcdCgSent[lcdTarget - LCD_CELLS] = lcdByte;
+    }
+    lcdCursor++;
+    return 1;
+  }
+  if (lcdCgDirty)
+  {
+    for (i=0;i<LCD_CG_BYTES && lcdCg[i]==lcdCgSent[i];i++);
+    if (i < LCD_CG_BYTES)
+    {
+      target = LCD_CELLS + i;
+      addr = LCD_CG_CURSOR + i;
+    }
+    else
+    {
+      lcdCgDirty = 0;
+    }
+  }
+  if (target < 0)
+  {
+    for (i=0;i<LCD_CELLS;i++)
+    {
+      target = (lcdScan + i) % LCD_CELLS;
+      if (lcdFb[target] != lcdSent[target]) break;
+    }
+    if (i == LCD_CELLS) return 0;	// up to date
+    lcdScan = target;
+    addr = lcd_fb_addr(target);
+  }
+  if (!lcd_no_busy && busy_lcd()) return 1;	// last byte still running
+  if (lcdCursor != addr)
+  {
+    lcdByte = addr >= LCD_CG_CURSOR ? 0x40 | (addr - LCD_CG_CURSOR) : 0x80 | addr;
+    lcdTarget = -1;
+    lcd_rs_clr();
+  }
+  else
+  {
+    lcdByte = target < LCD_CELLS ? lcdFb[target] : lcdCg[target - LCD_CELLS];
+    lcdTarget = target;
+    lcd_rs_set();
+  }
+  lcd_out_data4(lcdByte >> 4);		// High Nibble
+  enable_lcd();
+  lcdLowNibble = 1;
+  return 1;
+}
+
+/* Send all changed cells now, blocking, lcd_fb_tick() must not run
+ * at the same time
+ */
+void lcd_fb_flush(void)
+{
+  while (lcd_fb_tick())
+  {
+    if (!lcdLowNibble) lcd_wait_ready(LCD_EXEC_US);	// byte sent, bounded wait
+  }
+}
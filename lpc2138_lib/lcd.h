@@ -1,4 +1,4 @@
-#include <LPC213X.h>
+#include "hal.h"
 
 // Define LCD PinIO Mask 
 // xxxx xxx0 0000 0000 0000 0000 0000 0000
@@ -16,12 +16,12 @@
 //#define  lcd_dir_write()  IODIR |= 0xFE000000	// LCD Data Bus = Write
 //#define  lcd_dir_read()   IODIR &= 0x07FFFFFF	// LCD Data Bus = Read 
 
-#define  lcd_rs_set() IO1SET = LCD_RS	 	// RS = 1 (Select Instruction)
-#define  lcd_rs_clr() IO1CLR = LCD_RS		// RS = 0 (Select Data)
-#define  lcd_rw_set() IO1SET = LCD_RW		// RW = 1 (Read)
-#define  lcd_rw_clr() IO1CLR = LCD_RW		// RW = 0 (Write)
-#define  lcd_en_set() IO1SET = LCD_EN		// EN = 1 (Enable)
-#define  lcd_en_clr() IO1CLR = LCD_EN		// EN = 0 (Disable)
+#define  lcd_rs_set() hal_gpio_set(1, LCD_RS)	 	// RS = 1 (Select Instruction)
+#define  lcd_rs_clr() hal_gpio_clr(1, LCD_RS)		// RS = 0 (Select Data)
+#define  lcd_rw_set() hal_gpio_set(1, LCD_RW)		// RW = 1 (Read)
+#define  lcd_rw_clr() hal_gpio_clr(1, LCD_RW)		// RW = 0 (Write)
+#define  lcd_en_set() hal_gpio_set(1, LCD_EN)		// EN = 1 (Enable)
+#define  lcd_en_clr() hal_gpio_clr(1, LCD_EN)		// EN = 0 (Disable)
 
 #define  lcd_clear()          lcd_write_control(0x01)	// Clear Display
 #define  lcd_cursor_home()    lcd_write_control(0x02)	// Set Cursor = 0
@@ -37,6 +37,27 @@
 #define  lcd_goto_first_row()   lcd_write_control(0x80) // Goto first row
 #define  lcd_goto_second_row()  lcd_write_control(0xC0) // Goto second row
 
+// execution times of the controller (270 kHz), waited when the busy
+// flag cannot be read
+#define  LCD_EXEC_US     43     // most instructions and data
+#define  LCD_CLEAR_US    1640   // clear display, cursor home
+// give up on the busy flag after this, then wait the times above
+#define  LCD_BUSY_TIMEOUT_US  4000
+// timer used to calibrate lcd_wait_us() in lcd_init(), it is
+// stopped afterwards, call lcd_init() before the program starts it
+#ifndef  LCD_TIMER
+#define  LCD_TIMER  HAL_TIMER1
+#endif
+
+// shadow framebuffer, lcd_fb_xxx()
+#define  LCD_ROWS  2
+#define  LCD_COLS  16
+#define  LCD_ROW2_ADDR  0x40	// DD RAM address of the second row
+// user glyphs in CG RAM, shown as codes 8-15 (same as 0-7) so they
+// fit in a string
+#define  LCD_GLYPHS  8
+#define  LCD_GLYPH_CODE  8
+
 
 
 /* pototype  section */
@@ -49,7 +70,22 @@ extern void goto_cursor(unsigned char);		// Set Position Cursor LCD
 extern void lcd_print(unsigned char*);			// Print Display to LCD
 extern void lcd_print_string(char*); // Print string
 extern char busy_lcd(void);				// Read Busy LCD Status
+extern void lcd_wait_ready(unsigned int);		// Wait for Busy Flag, or the time given
+extern void lcd_wait_us(unsigned int);			// Calibrated Delay
+extern char lcd_no_busy;				// Busy Flag timed out, fixed delays
 extern void enable_lcd(void);	 			// Enable Pulse
 extern void delay(unsigned long int);			// Delay Function
 
+/* shadow framebuffer, the lcd_fb_ writes only change RAM and
+ * lcd_fb_tick() sends the changed cells a nibble per call, call it
+ * from a timer interrupt with a period of LCD_EXEC_US at least
+ * after lcd_fb_init() use only the lcd_fb_ functions
+ */
+extern void lcd_fb_init(void);				// Clear Buffer, call after lcd_init()
+extern void lcd_fb_putc(int, int, char);		// Write Character at Row, Column
+extern int lcd_fb_print(int, int, const char*);	// Write String at Row, Column
+extern int lcd_fb_tick(void);				// Send a Nibble, 0 = Display up to date
+extern void lcd_fb_flush(void);				// Send all, when no tick runs
+extern char lcd_glyph(const unsigned char*);		// Character for a 5x8 Bitmap, cached in CG RAM
+
 
@@ -11,6 +11,8 @@
 #define __RETARGET_H
 
 #include <stdio.h>
+
+#ifndef HAL_HOST // the host C library already has its stdout
 #include <rt_misc.h>
 
 #pragma import(__use_no_semihosting_swi)
@@ -43,4 +45,6 @@ void _sys_exit(int return_code) {
 label:  goto label;  /* endless loop */
 }
 
+#endif // !HAL_HOST
+
 #endif // __RETARGET_H
@@ -1,6 +1,34 @@
 #ifndef __UART0_H
 #define __UART0_H
 
+// receive ring of uart0_init_int(), power of 2
+#ifndef UART0_RX_SIZE
+#define UART0_RX_SIZE 64
+#endif
+// transmit ring of uart0_init_int(), power of 2
+#ifndef UART0_TX_SIZE
+#define UART0_TX_SIZE 256
+#endif
+// what uart0_putchar() does when the transmit ring is full
+#define UART0_TX_DROP 0      // drop the new character
+#define UART0_TX_BLOCK 1     // wait for room
+#define UART0_TX_OVERWRITE 2 // drop the oldest character
+#ifndef UART0_TX_POLICY
+#define UART0_TX_POLICY UART0_TX_DROP
+#endif
+// VIC slot of the UART0 interrupt, 0-15, not used by the program
+#ifndef UART0_VIC_SLOT
+#define UART0_VIC_SLOT 4
+#endif
+// UART0_PRINTF = 1 sends printf() to uart0_printf(), the C library
+// formatter is not linked, include this file after <stdio.h>
+#ifndef UART0_PRINTF
+#define UART0_PRINTF 0
+#endif
+
+extern unsigned int uart0RxDropped;
+extern unsigned int uart0TxDropped;
+
 /* initialize uart0 with appropriate baudrate */
 extern void uart0_init(unsigned int baudrate);
 
@@ -9,20 +37,61 @@ extern void uart0_init(unsigned int baudrate);
  */
 extern int uart0_putchar(int);
 
+/* receive and transmit through the UART0 interrupt and ring
+ * buffers, call after uart0_init()
+ */
+extern void uart0_init_int(void);
+
+/* UART0_TX_DROP, UART0_TX_BLOCK or UART0_TX_OVERWRITE,
+ * returns the old policy
+ */
+extern int uart0_set_tx_policy(int);
+
+/* free bytes in the transmit ring, UART0_TX_SIZE before
+ * uart0_init_int() as the writes wait for the transmitter
+ */
+extern int uart0_tx_free(void);
+
+/* write binary data, no CR is added before LF */
+extern void uart0_write(const unsigned char *, int);
+
 /* get character from standard input */
 extern int uart0_getchar(void);
 
+/* get character if one has been received, otherwise -1 */
+extern int uart0_try_getchar(void);
+
 /* print string to standard output */
 extern int uart0_puts(char *);
 
-/* print integer */
+/* print integer, format.c does the digits without division */
 extern void uart0_print_int(int);
 
-/* print floating point number */
+/* print hex or binary, padded with 0 to digits, 0 = no padding */
+extern void uart0_print_hex(unsigned int, int);
+extern void uart0_print_bin(unsigned int, int);
+
+/* print fixed point number with frac_bits fraction bits (16 for
+ * Q16.16, 24 for Q8.24) rounded to precision decimals
+ */
+extern void uart0_print_fixed(int, int, int);
+
+/* printf() subset of fmt_vprint() (format.h) written straight into
+ * the transmit path: %d %i %u %x %X %c %s %%, - and 0, width
+ */
+extern int uart0_printf(const char *, ...);
+
+/* print floating point number, rounded to precision decimals
+ * (FMT_PRECISION_MAX at most), prefer uart0_print_fixed(), this one
+ * needs the floating point library and is in uart0_double.c
+ */
 extern void uart0_print_double(double ,int);
 
 /* get multiple characters from standard input */
 extern void uart0_getline(char *line, int n);
 
+#if UART0_PRINTF
+#define printf uart0_printf
+#endif
 
 #endif // __UART0_H
@@ -0,0 +1,26 @@
+/*
+* uart0_print_double() on its own, a program that does not call it
+* links without the floating point library, add this file to the
+* project only where a double has to be printed
+*/
+#include "uart0.h"
+#include "format.h"
+
+/*
+ * two floating point operations split num into a whole part and a
+ * 32 bit fraction, the digits come from fmt_fraction()
+ * num is rounded, not truncated, |num| < 2^32
+ */
+void uart0_print_double(double num, int precision)
+{
+	char buf[FMT_SIZE];
+	int negative = num < 0;
+	unsigned int whole;
+
+	if(negative){
+		num = -num;
+	}
+	whole = (unsigned int) num;
+	uart0_write((const unsigned char *) buf, fmt_fraction(buf, negative, whole,
+		(unsigned int) ((num - whole) * 4294967296.0), precision));
+}
@@ -0,0 +1,181 @@
+/*****************************************************************
+*
+*                          Function wheel.c
+*
+*  hierarchical timer wheel, WHEEL_LEVELS wheels of WHEEL_SIZE
+*  slots, level n slots are WHEEL_SIZE^n ticks wide
+*
+*  a timer goes into the slot of the lowest level its delay fits,
+*  a list insert, and is taken out by its pprev link, so start and
+*  cancel cost the same for any number of timers
+*  each tick runs the level 0 slot of that tick, when level 0 comes
+*  round the next level 1 slot is spread over level 0, and so on
+*  up (cascade), a timer moves down at most WHEEL_LEVELS - 1 times
+*
+*  a periodic timer is queued again period ticks after the expiry
+*  it was due at, not after the tick it ran in, so it does not
+*  drift, wheel_set_period() takes effect from the next expiry
+*  with nothing restarted
+*
+*  start, cancel and the period can be changed from the handlers,
+*  the main program masks the tick while it changes the lists
+*
+******************************************************************/
+
+#include "wheel.h"
+
+HAL_TIMER_OWNER(WHEEL_CHANNEL);
+
+static wheel_timer *wheelSlot[WHEEL_LEVELS][WHEEL_SIZE];
+static volatile unsigned int wheelNow;
+static char wheelInIrq;
+
+__irq void wheelIRQ(void);
+
+/* Tick WHEEL_HZ times a second on MR0 of WHEEL_TIMER */
+void wheel_init(void)
+{
+	int level, index;
+
+	for(level = 0; level < WHEEL_LEVELS; level++){
+		for(index = 0; index < WHEEL_SIZE; index++){
+			wheelSlot[level][index] = 0;
+		}
+	}
+	wheelNow = 0;
+	hal_irq_install(WHEEL_SLOT, WHEEL_CHANNEL, wheelIRQ);
+	hal_timer_start(WHEEL_TIMER, 0, HAL_PCLK / WHEEL_HZ - 1);
+}
+
+unsigned int wheel_now(void)
+{
+	return(wheelNow);
+}
+
+static void wheel_link(wheel_timer **head, wheel_timer *timer)
+{
+	timer->next = *head;
+	if(timer->next){
+		timer->next->pprev = &timer->next;
+	}
+	timer->pprev = head;
+	*head = timer;
+}
+
+static void wheel_unlink(wheel_timer *timer)
+{
+	*timer->pprev = timer->next;
+	if(timer->next){
+		timer->next->pprev = timer->pprev;
+	}
+	timer->pprev = 0;
+}
+
+// the slot for timer->expires, seen from wheelNow
+static void wheel_insert(wheel_timer *timer)
+{
+	unsigned int delta = timer->expires - wheelNow;
+	unsigned int expires = timer->expires;
+	int level = 0;
+
+	if(delta >= WHEEL_SPAN){
+		expires = wheelNow + WHEEL_SPAN - 1; // comes back down from there
+		delta = WHEEL_SPAN - 1;
+	}
+	while(delta >= WHEEL_SIZE){
+		delta >>= WHEEL_BITS;
+		level++;
+	}
+	wheel_link(&wheelSlot[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK], timer);
+}
+
+/* Run handler delay ticks from now, then every period ticks if not 0,
+ * a pending timer is moved
+ */
+void wheel_start(wheel_timer *timer, unsigned int delay, unsigned int period,
+	void (*handler)(void))
+{
+	if(!wheelInIrq){
+		hal_irq_disable(WHEEL_CHANNEL);
+	}
+	if(timer->pprev){
+		wheel_unlink(timer);
+	}
+	timer->handler = handler;
+	timer->period = period;
+	timer->expires = wheelNow + (delay ? delay : 1);
+	wheel_insert(timer);
+	if(!wheelInIrq){
+		hal_irq_enable(WHEEL_CHANNEL);
+	}
+}
+
+void wheel_cancel(wheel_timer *timer)
+{
+	if(!wheelInIrq){
+		hal_irq_disable(WHEEL_CHANNEL);
+	}
+	if(timer->pprev){
+		wheel_unlink(timer);
+	}
+	if(!wheelInIrq){
+		hal_irq_enable(WHEEL_CHANNEL);
+	}
+}
+
+/* A new period from the next expiry on, the one queued stays */
+void wheel_set_period(wheel_timer *timer, unsigned int period)
+{
+	timer->period = period;
+}
+
+// spread a slot of level over the levels below
+static void wheel_cascade(int level, int index)
+{
+	wheel_timer *list = wheelSlot[level][index];
+	wheel_timer *timer;
+
+	wheelSlot[level][index] = 0;
+	while(list){
+		timer = list;
+		list = timer->next;
+		timer->pprev = 0;
+		wheel_insert(timer);
+	}
+}
+
+/* Tick: cascade on a level 0 wrap, then run the timers due now */
+__irq void wheelIRQ(void)
+{
+	wheel_timer *list;
+	wheel_timer *timer;
+	unsigned int now;
+	int level;
+
+	hal_timer_clear_int(WHEEL_TIMER);
+	wheelInIrq = 1;
+	now = ++wheelNow;
+	// the highest level that wrapped goes first, it may fill the
+	// slot of the level below that is due at the same tick
+	for(level = 1; level < WHEEL_LEVELS && !(now & ((1UL << (WHEEL_BITS * level)) - 1)); level++);
+	while(--level > 0){
+		wheel_cascade(level, (now >> (WHEEL_BITS * level)) & WHEEL_MASK);
+	}
+	// detach the slot, a handler may cancel a timer still on it
+	list = wheelSlot[0][now & WHEEL_MASK];
+	wheelSlot[0][now & WHEEL_MASK] = 0;
+	if(list){
+		list->pprev = &list;
+	}
+	while(list){
+		timer = list;
+		wheel_unlink(timer);
+		if(timer->period){
+			timer->expires += timer->period;
+			wheel_insert(timer);
+		}
+		timer->handler();
+	}
+	wheelInIrq = 0;
+	hal_irq_end();
+}
@@ -0,0 +1,61 @@
+/*****************************************************************
+*
+*                          Function wheel.h
+*
+*  software timers on one hardware timer, a hierarchical timer
+*  wheel ticked by MR0 of WHEEL_TIMER, see wheel.c
+*
+*  the wheel takes the PWM block, Timer1 is left to the delays
+*  (delay.h), a build that puts both on one timer stops with an
+*  error, at compile time if a file includes both headers, at link
+*  time otherwise (HAL_TIMER_OWNER)
+*
+******************************************************************/
+
+#ifndef __WHEEL_H
+#define __WHEEL_H
+
+#include "hal.h"
+#include "lpc213x_vic.h"
+
+// the timer, its VIC channel and vector slot, ticks per second
+#ifndef WHEEL_TIMER
+#define WHEEL_TIMER HAL_PWM
+#define WHEEL_CHANNEL VIC_PWM0
+#endif
+#ifndef WHEEL_SLOT
+#define WHEEL_SLOT 2
+#endif
+#if defined(DELAY_CHANNEL) && DELAY_CHANNEL == WHEEL_CHANNEL
+#error "wheel.h and delay.h on the same timer"
+#endif
+#ifndef WHEEL_HZ
+#define WHEEL_HZ 1000
+#endif
+
+// slots per level, levels
+#define WHEEL_BITS 6
+#define WHEEL_LEVELS 3
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+// ticks the wheel can hold in one go, a longer timer is taken
+// around the last level again
+#define WHEEL_SPAN (1UL << (WHEEL_BITS * WHEEL_LEVELS))
+
+// a timer, owned by the caller and left alone while it is pending
+typedef struct wheel_timer {
+	struct wheel_timer *next;
+	struct wheel_timer **pprev;	// what points at this one, 0 = idle
+	unsigned int expires;		// tick of the next expiry
+	unsigned int period;		// ticks, 0 = one-shot
+	void (*handler)(void);		// run in the tick interrupt
+} wheel_timer;
+
+extern void wheel_init(void);
+extern unsigned int wheel_now(void);	// ticks since wheel_init()
+extern void wheel_start(wheel_timer *, unsigned int, unsigned int, void (*)(void));
+extern void wheel_cancel(wheel_timer *);
+extern void wheel_set_period(wheel_timer *, unsigned int);
+#define wheel_pending(timer) ((timer)->pprev != 0)
+
+#endif // __WHEEL_H